@@ -0,0 +1,51 @@
+#ifndef BENCHMARKS
+#define BENCHMARKS
+
+#include <QElapsedTimer>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Benchmarks of the feature pipeline
+ * Every benchmark gets the 16-bit mono samples of the WAV file given on the command line, or a generated signal of
+ * a few minutes, and prints its timings with qDebug. They are kept out of the application and run by hand:
+ *
+ *     benchmarks [-w file.wav] [name ...]
+ */
+struct BenchmarkInput {
+    std::vector<int16_t>    samples;
+    size_t                  fs;
+};
+
+// Repeats of a few seconds of coloured noise with a little fresh noise on top, so that repetition search finds
+// something and every frame still differs
+BenchmarkInput generatedInput(size_t seconds = 120, size_t fs = 44100);
+// Samples of a 16-bit PCM WAV file, the channels after the first are dropped. False if the file cannot be read.
+bool readWavInput(const char* fileName, BenchmarkInput &input);
+
+// Static MFCCs of every frame with the default configuration at the sampling rate of input
+std::vector<std::vector<double>> extractMfccs(const BenchmarkInput &input);
+
+// Fastest of repeats runs of fn in milliseconds, fn is a lambda so the template lives here
+template <typename Function>
+double bestOfMs(size_t repeats, Function fn) {
+    double best = 0;
+    for (size_t r=0; r<repeats; r++) {
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        double ms = timer.nsecsElapsed() / 1e6;
+        if (r == 0 || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+void benchmarkFFT(const BenchmarkInput &input);
+void benchmarkMfcc(const BenchmarkInput &input);
+void benchmarkMfccAccuracy(const BenchmarkInput &input);
+void benchmarkRepetitionSearch(const BenchmarkInput &input);
+void benchmarkSimilarity(const BenchmarkInput &input);
+
+#endif // BENCHMARKS
@@ -0,0 +1,33 @@
+TEMPLATE = app
+TARGET = benchmarks
+
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+HEADERS += benchmarks.h \
+    ../fftplan.h \
+    ../mfccextractor.h \
+    ../repetitionindex.h \
+    ../simdkernels.h \
+    ../similaritymatrix.h \
+    ../spectralfeatures.h
+
+SOURCES += main.cpp \
+    fftbenchmark.cpp \
+    mfccbenchmark.cpp \
+    repetitionbenchmark.cpp \
+    similaritybenchmark.cpp \
+    ../fftplan.cpp \
+    ../mfccextractor.cpp \
+    ../repetitionindex.cpp \
+    ../simdkernels.cpp \
+    ../similaritymatrix.cpp \
+    ../spectralfeatures.cpp
+
+LIBS += $$PWD/../libfftw3.a
+
+include(../simdkernels.pri)
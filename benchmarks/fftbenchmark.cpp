@@ -0,0 +1,143 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <complex>
+#include <map>
+#include <math.h>
+
+#include <QDebug>
+#include <QMutex>
+
+#include "fftplan.h"
+#include "mfccextractor.h"
+
+/* The recursive FFT that FFTPlan replaced, kept as the baseline
+ * Every call copies its input, allocates the even and odd halves and looks each twiddle factor up in a nested map.
+ */
+static std::map<int, std::map<int, std::complex<double>>> recursiveTwiddle;
+
+static void computeRecursiveTwiddle(size_t numFFT) {
+    const std::complex<double> J(0,1);
+    const double PI = 4*atan(1.0);
+    for (size_t n=2; n<=numFFT; n*=2)
+        for (size_t k=0; k<=n/2-1; k++)
+            recursiveTwiddle[n][k] = exp(-2*PI*k/n*J);
+}
+
+static std::vector<std::complex<double>> recursiveFFT(std::vector<std::complex<double>> x) {
+    size_t N = x.size();
+    if (N==1)
+        return x;
+
+    std::vector<std::complex<double>> xe(N/2,0), xo(N/2,0), Xjo, Xjo2;
+    for (size_t i=0; i<N; i+=2)
+        xe[i/2] = x[i];
+    for (size_t i=1; i<N; i+=2)
+        xo[(i-1)/2] = x[i];
+
+    Xjo = recursiveFFT(xe);
+    Xjo2 = recursiveFFT(xo);
+    Xjo.insert (Xjo.end(), Xjo2.begin(), Xjo2.end());
+
+    for (size_t i=0; i<=N/2-1; i++) {
+        std::complex<double> t = Xjo[i], tw = recursiveTwiddle[N][i];
+        Xjo[i] = t + tw * Xjo[i+N/2];
+        Xjo[i+N/2] = t - tw * Xjo[i+N/2];
+    }
+    return Xjo;
+}
+
+/* Power spectrum of consecutive frames
+ * The recursive FFT on a complex copy of the frame as compPowerSpec did it, the real-input FFTPlan in double and
+ * float, and FFTW's r2c plan. Time per frame is the best of 5 passes, the difference is the largest one of any bin
+ * relative to the largest bin of the frame, against FFTW.
+ */
+void benchmarkFFT(const BenchmarkInput &input) {
+    const size_t sizes[] = { 256, 512, 1024 };
+    for (size_t numFFT : sizes) {
+        size_t numBins = numFFT / 2 + 1;
+        size_t numFrames = std::min((size_t) 2000, input.samples.size() / numFFT);
+        if (numFrames == 0)
+            continue;
+        std::vector<double> frames(numFrames * numFFT);
+        for (size_t i=0; i<frames.size(); i++)
+            frames[i] = input.samples[i];
+
+        std::vector<double> reference(numFrames * numBins), power(numFrames * numBins);
+        auto maxDifference = [&]() {
+            double difference = 0;
+            for (size_t k=0; k<numFrames; k++) {
+                const double* r = &reference[k * numBins];
+                const double* p = &power[k * numBins];
+                double peak = *std::max_element(r, r + numBins);
+                for (size_t i=0; i<numBins; i++)
+                    if (peak > 0)
+                        difference = std::max(difference, fabs(p[i] - r[i]) / peak);
+            }
+            return difference;
+        };
+
+        double* fftwIn = (double*) fftw_malloc(sizeof(double) * numFFT);
+        fftw_complex* fftwOut = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * numBins);
+        fftw_plan plan;
+        {
+            QMutexLocker locker(&fftwPlannerMutex());
+            plan = fftw_plan_dft_r2c_1d(numFFT, fftwIn, fftwOut, FFTW_MEASURE);
+        }
+        double fftwMs = bestOfMs(5, [&]() {
+            for (size_t k=0; k<numFrames; k++) {
+                std::copy(&frames[k * numFFT], &frames[(k + 1) * numFFT], fftwIn);
+                fftw_execute(plan);
+                for (size_t i=0; i<numBins; i++)
+                    reference[k * numBins + i] = fftwOut[i][0] * fftwOut[i][0] + fftwOut[i][1] * fftwOut[i][1];
+            }
+        });
+        {
+            QMutexLocker locker(&fftwPlannerMutex());
+            fftw_destroy_plan(plan);
+        }
+        fftw_free(fftwIn);
+        fftw_free(fftwOut);
+
+        computeRecursiveTwiddle(numFFT);
+        double recursiveMs = bestOfMs(5, [&]() {
+            for (size_t k=0; k<numFrames; k++) {
+                std::vector<std::complex<double>> framec(&frames[k * numFFT], &frames[(k + 1) * numFFT]);
+                std::vector<std::complex<double>> fftc = recursiveFFT(framec);
+                for (size_t i=0; i<numBins; i++)
+                    power[k * numBins + i] = pow(abs(fftc[i]), 2);
+            }
+        });
+        double recursiveDifference = maxDifference();
+
+        FFTPlan<double> planDouble(numFFT);
+        std::vector<std::complex<double>> bins(numBins);
+        double planMs = bestOfMs(5, [&]() {
+            for (size_t k=0; k<numFrames; k++) {
+                planDouble.transformReal(&frames[k * numFFT], bins.data());
+                for (size_t i=0; i<numBins; i++)
+                    power[k * numBins + i] = std::norm(bins[i]);
+            }
+        });
+        double planDifference = maxDifference();
+
+        FFTPlan<float> planFloat(numFFT);
+        std::vector<float> framesFloat(frames.begin(), frames.end());
+        std::vector<std::complex<float>> binsFloat(numBins);
+        double planFloatMs = bestOfMs(5, [&]() {
+            for (size_t k=0; k<numFrames; k++) {
+                planFloat.transformReal(&framesFloat[k * numFFT], binsFloat.data());
+                for (size_t i=0; i<numBins; i++)
+                    power[k * numBins + i] = std::norm(binsFloat[i]);
+            }
+        });
+        double planFloatDifference = maxDifference();
+
+        double perFrame = 1000.0 / numFrames;
+        qDebug() << numFFT << "points, us per frame:";
+        qDebug() << "  recursive" << recursiveMs * perFrame << "difference" << recursiveDifference;
+        qDebug() << "  FFTPlan<double>" << planMs * perFrame << "difference" << planDifference;
+        qDebug() << "  FFTPlan<float>" << planFloatMs * perFrame << "difference" << planFloatDifference;
+        qDebug() << "  FFTW" << fftwMs * perFrame;
+    }
+}
@@ -0,0 +1,141 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#include <QDebug>
+
+#include "mfccextractor.h"
+
+BenchmarkInput generatedInput(size_t seconds, size_t fs) {
+    BenchmarkInput input;
+    input.fs = fs;
+    input.samples.resize(seconds * fs);
+
+    // Every 100 ms of the motif has its own level and spectral tilt
+    std::mt19937 generator(1);
+    std::normal_distribution<double> normal(0, 2000);
+    std::uniform_real_distribution<double> pole(-0.9, 0.95), gain(0.1, 3);
+    std::vector<double> motif(7 * fs);
+    double state = 0, a = 0, g = 1;
+    for (size_t i=0; i<motif.size(); i++) {
+        if (i % (fs / 10) == 0) {
+            a = pole(generator);
+            g = gain(generator);
+        }
+        state = a * state + normal(generator) * g;
+        motif[i] = state;
+    }
+    for (size_t i=0; i<input.samples.size(); i++) {
+        double x = motif[i % motif.size()] + 0.05 * normal(generator);
+        input.samples[i] = (int16_t) std::max(-32768.0, std::min(32767.0, x));
+    }
+    return input;
+}
+
+// Walks the RIFF chunks to "fmt " and "data", so that files with further chunks are read as well
+bool readWavInput(const char* fileName, BenchmarkInput &input) {
+    std::ifstream file(fileName, std::ios::binary);
+    char riff[12];
+    if (!file.read(riff, sizeof(riff)) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+        return false;
+
+    uint16_t format = 0, channels = 0, bits = 0;
+    uint32_t rate = 0;
+    char id[4];
+    uint32_t size;
+    while (file.read(id, 4) && file.read((char *) &size, 4)) {
+        if (memcmp(id, "fmt ", 4) == 0) {
+            // PCM needs the 16 bytes up to the bits per sample
+            if (size < 16)
+                return false;
+            std::vector<char> fmt(size);
+            if (!file.read(fmt.data(), size))
+                return false;
+            if (size & 1)
+                file.seekg(1, std::ios::cur);
+            memcpy(&format, &fmt[0], 2);
+            memcpy(&channels, &fmt[2], 2);
+            memcpy(&rate, &fmt[4], 4);
+            memcpy(&bits, &fmt[14], 2);
+        } else if (memcmp(id, "data", 4) == 0) {
+            if (format != 1 || bits != 16 || channels == 0 || rate == 0)
+                return false;
+            std::vector<int16_t> interleaved(size / 2);
+            file.read((char *) interleaved.data(), interleaved.size() * 2);
+            interleaved.resize(file.gcount() / 2);
+            input.fs = rate;
+            input.samples.clear();
+            for (size_t i=0; i+channels<=interleaved.size(); i+=channels)
+                input.samples.push_back(interleaved[i]);
+            return true;
+        } else {
+            file.seekg(size + (size & 1), std::ios::cur);
+        }
+    }
+    return false;
+}
+
+std::vector<std::vector<double>> extractMfccs(const BenchmarkInput &input) {
+    MfccExtractor<double> extractor(input.fs);
+    std::vector<std::vector<double>> mfccs;
+    if (input.samples.size() < extractor.overlapSamples())
+        return mfccs;
+    size_t numFrames = (input.samples.size() - extractor.overlapSamples()) / extractor.shiftSamples();
+    extractor.setOverlap(input.samples.data());
+    extractor.processBlock(input.samples.data() + extractor.overlapSamples(), numFrames, mfccs);
+    return mfccs;
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)(const BenchmarkInput &input);
+};
+
+static const Benchmark benchmarks[] = {
+    { "fft", benchmarkFFT },
+    { "mfcc", benchmarkMfcc },
+    { "accuracy", benchmarkMfccAccuracy },
+    { "repetition", benchmarkRepetitionSearch },
+    { "similarity", benchmarkSimilarity },
+};
+
+int main(int argc, char *argv[])
+{
+    BenchmarkInput input;
+    std::vector<const char*> names;
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            if (!readWavInput(argv[++i], input)) {
+                qDebug() << "Not a 16-bit PCM WAV file:" << argv[i];
+                return 1;
+            }
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+    if (input.samples.empty())
+        input = generatedInput();
+    qDebug() << input.samples.size() / input.fs << "s of samples at" << input.fs << "Hz";
+
+    int ran = 0;
+    for (const Benchmark &benchmark : benchmarks) {
+        bool selected = names.empty();
+        for (const char* name : names)
+            selected |= strcmp(name, benchmark.name) == 0;
+        if (!selected)
+            continue;
+        qDebug() << "*****" << benchmark.name << "*****";
+        benchmark.run(input);
+        ran++;
+    }
+    if (ran == 0) {
+        qDebug() << "Unknown benchmark, available:";
+        for (const Benchmark &benchmark : benchmarks)
+            qDebug() << benchmark.name;
+        return 1;
+    }
+    return 0;
+}
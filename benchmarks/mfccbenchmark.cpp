@@ -0,0 +1,105 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include <QDebug>
+
+#include "mfccextractor.h"
+
+// Milliseconds to extract every frame of input with extractor, frame by frame or in blocks, best of 3 runs
+template <typename T>
+static double extractionMs(MfccExtractor<T> &extractor, const BenchmarkInput &input, bool blocks, size_t &numFrames) {
+    numFrames = (input.samples.size() - extractor.overlapSamples()) / extractor.shiftSamples();
+    std::vector<std::vector<T>> mfccs;
+    mfccs.reserve(numFrames);
+    volatile T sink = 0;
+    return bestOfMs(3, [&]() {
+        const int16_t* frame = input.samples.data() + extractor.overlapSamples();
+        extractor.setOverlap(input.samples.data());
+        if (blocks) {
+            mfccs.clear();
+            extractor.processBlock(frame, numFrames, mfccs);
+            sink = mfccs.back()[0];
+        } else {
+            for (size_t k=0; k<numFrames; k++, frame += extractor.shiftSamples())
+                sink = extractor.processFrame(frame)[0];
+        }
+    });
+}
+
+template <typename T>
+static void reportThroughput(const char* precision, const BenchmarkInput &input) {
+    const SpectrumBackend backends[] = { BuiltinFFT, FFTW };
+    const mfccKernels<T>* kernelSets[] = { &mfccKernelsScalar<T>(), &mfccKernelsDetected<T>() };
+    for (SpectrumBackend backend : backends) {
+        for (size_t k=0; k<2; k++) {
+            // Without SIMD kernels the detected set is the scalar one
+            const mfccKernels<T>* kernels = kernelSets[k];
+            if (k > 0 && kernels == kernelSets[0])
+                break;
+            MfccExtractor<T> extractor(input.fs);
+            extractor.setSpectrumBackend(backend);
+            extractor.setKernels(*kernels);
+            if (input.samples.size() < extractor.overlapSamples() + extractor.shiftSamples())
+                return;
+
+            size_t numFrames;
+            double frameMs = extractionMs(extractor, input, false, numFrames);
+            double blockMs = extractionMs(extractor, input, true, numFrames);
+            double seconds = double(input.samples.size()) / input.fs;
+            qDebug() << precision << (backend == FFTW ? "FFTW" : "builtin FFT") << kernels->name
+                     << "us per frame:" << 1000 * frameMs / numFrames << "by frame," << 1000 * blockMs / numFrames
+                     << "in blocks, x" << 1000 * seconds / std::min(frameMs, blockMs) << "real time";
+        }
+    }
+}
+
+/* MFCC throughput
+ * Time per frame of MfccExtractor in float and double, with the builtin FFT and with FFTW, with the scalar and the
+ * detected kernels, frame by frame and in blocks.
+ */
+void benchmarkMfcc(const BenchmarkInput &input) {
+    reportThroughput<float>("float", input);
+    reportThroughput<double>("double", input);
+}
+
+/* Accuracy of the float extractor
+ * The MFCCs of MfccExtractor<float> against MfccExtractor<double> on the same frames, both with the detected kernels
+ * and the builtin FFT. Per coefficient the largest and the RMS difference, and the RMS of the coefficient itself
+ * to put them in proportion.
+ */
+void benchmarkMfccAccuracy(const BenchmarkInput &input) {
+    MfccExtractor<float> single(input.fs);
+    MfccExtractor<double> reference(input.fs);
+    single.setSpectrumBackend(BuiltinFFT);
+    reference.setSpectrumBackend(BuiltinFFT);
+    if (input.samples.size() < reference.overlapSamples() + reference.shiftSamples())
+        return;
+
+    size_t numFrames = (input.samples.size() - reference.overlapSamples()) / reference.shiftSamples();
+    std::vector<std::vector<float>> actual;
+    std::vector<std::vector<double>> expected;
+    single.setOverlap(input.samples.data());
+    single.processBlock(input.samples.data() + single.overlapSamples(), numFrames, actual);
+    reference.setOverlap(input.samples.data());
+    reference.processBlock(input.samples.data() + reference.overlapSamples(), numFrames, expected);
+
+    size_t numCoefficients = reference.numCoefficients();
+    std::vector<double> maxError(numCoefficients, 0), sumSquaredError(numCoefficients, 0), sumSquares(numCoefficients, 0);
+    for (size_t k=0; k<numFrames; k++) {
+        for (size_t i=0; i<numCoefficients; i++) {
+            double error = fabs(actual[k][i] - expected[k][i]);
+            maxError[i] = std::max(maxError[i], error);
+            sumSquaredError[i] += error * error;
+            sumSquares[i] += expected[k][i] * expected[k][i];
+        }
+    }
+
+    qDebug() << numFrames << "frames, float against double:";
+    for (size_t i=0; i<numCoefficients; i++)
+        qDebug() << "  coefficient" << i << "max" << maxError[i] << "rms" << sqrt(sumSquaredError[i] / numFrames)
+                 << "of rms" << sqrt(sumSquares[i] / numFrames);
+    double worst = *std::max_element(maxError.begin(), maxError.end());
+    qDebug() << "Largest difference" << worst;
+}
@@ -0,0 +1,48 @@
+#include "benchmarks.h"
+
+#include <QDebug>
+
+#include "repetitionindex.h"
+
+/* Repetition search
+ * The pairs within maxDistance found by RepetitionIndex against the exact O(N^2) search, for a few table and bit
+ * counts. Both lists are sorted by (i, j). A pair right at maxDistance may be rounded to either side by dot and
+ * dotRows, so the pairs found are matched against the exact ones instead of just counted.
+ */
+void benchmarkRepetitionSearch(const BenchmarkInput &input) {
+    const float maxDistance = 2e-5f;
+    const size_t minLag = 100;
+
+    FeatureMatrix features;
+    features.assign(extractMfccs(input));
+
+    std::vector<SimilarPair> exact;
+    double exactMs = bestOfMs(1, [&]() { exact = exactSimilarPairs(features, maxDistance, minLag); });
+    qDebug() << features.rows() << "frames, exact search" << exactMs << "ms," << exact.size() << "pairs";
+
+    const size_t configs[][2] = { { 8, 16 }, { 12, 16 }, { 16, 16 }, { 12, 12 }, { 24, 20 } };
+    for (const size_t* config : configs) {
+        std::vector<SimilarPair> found;
+        double indexMs = bestOfMs(1, [&]() {
+            RepetitionIndex index(config[0], config[1]);
+            index.build(features);
+            found = index.similarPairs(features, maxDistance, minLag);
+        });
+
+        size_t matched = 0;
+        for (size_t a=0, b=0; a<found.size() && b<exact.size(); ) {
+            if (found[a].i == exact[b].i && found[a].j == exact[b].j) {
+                matched++;
+                a++;
+                b++;
+            } else if (found[a].i < exact[b].i || (found[a].i == exact[b].i && found[a].j < exact[b].j)) {
+                a++;
+            } else {
+                b++;
+            }
+        }
+        double recall = exact.empty() ? 1 : double(matched) / exact.size();
+        qDebug() << config[0] << "tables of" << config[1] << "bits:" << indexMs << "ms," << found.size()
+                 << "pairs, recall" << recall;
+    }
+}
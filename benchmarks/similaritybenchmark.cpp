@@ -0,0 +1,76 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include <QDebug>
+
+#include "similaritymatrix.h"
+
+// The measure as it was computed before FeatureMatrix: both frames copied and both norms computed for every pair
+static double cosineByValue(std::vector<double> veca, std::vector<double> vecb) {
+    double multiply = 0.0;
+    double d_a = 0.0;
+    double d_b = 0.0;
+
+    std::vector<double>::iterator itera, iterb;
+    for (itera = veca.begin(), iterb = vecb.begin(); itera != veca.end(); itera++, iterb++) {
+        multiply += *itera * *iterb;
+        d_a += *itera * *itera;
+        d_b += *iterb * *iterb;
+    }
+    return multiply / (sqrt(d_a) * sqrt(d_b));
+}
+
+/* Self-similarity of the first 790 frames
+ * The 365 x 790 trapezoid of the old processTo, the frames copied into veca and vecb and passed by value, against
+ * the same trapezoid from the normalised FeatureMatrix with one dotRows call per row, normalisation included. The
+ * full packed matrix of the frames is timed as well, on one thread and on the thread pool. Best of 20 runs.
+ */
+void benchmarkSimilarity(const BenchmarkInput &input) {
+    std::vector<std::vector<double>> mfccs = extractMfccs(input);
+    size_t numFrames = std::min(mfccs.size(), (size_t) 790);
+    size_t numRows = std::min(numFrames, (size_t) 365);
+    mfccs.resize(numFrames);
+
+    std::vector<double> before;
+    before.reserve(numRows * numFrames);
+    double beforeMs = bestOfMs(20, [&]() {
+        before.clear();
+        std::vector<double> veca, vecb;
+        for (size_t j=0; j<numRows; j++) {
+            veca = mfccs[j];
+            for (size_t i=j; i<numFrames; i++) {
+                vecb = mfccs[i];
+                before.push_back(1 - cosineByValue(veca, vecb));
+            }
+        }
+    });
+
+    const mfccKernels<double> &kernels = mfccKernelsDetected<double>();
+    std::vector<double> after(before.size()), dots(numFrames);
+    FeatureMatrix features;
+    double afterMs = bestOfMs(20, [&]() {
+        features.assign(mfccs);
+        size_t k = 0;
+        for (size_t j=0; j<numRows; j++) {
+            kernels.dotRows(features.row(j), features.row(j), features.stride(), features.dims(), numFrames - j,
+                            dots.data());
+            for (size_t i=j; i<numFrames; i++)
+                after[k++] = 1 - dots[i - j];
+        }
+    });
+
+    double difference = 0;
+    for (size_t k=0; k<before.size(); k++)
+        difference = std::max(difference, fabs(after[k] - before[k]));
+
+    PackedSimilarityMatrix<float> matrix;
+    double matrixMs = bestOfMs(20, [&]() { computeSimilarityMatrix(features, matrix, kernels); });
+    double parallelMs = bestOfMs(20, [&]() { computeSimilarityMatrixParallel(features, matrix, kernels); });
+
+    qDebug() << numRows << "x" << numFrames << "trapezoid, ms:";
+    qDebug() << "  by value" << beforeMs;
+    qDebug() << "  FeatureMatrix" << afterMs << "difference" << difference;
+    qDebug() << "Full matrix of" << numFrames << "frames, ms:" << matrixMs << "one thread," << parallelMs << "pool";
+}
@@ -0,0 +1,103 @@
+#include "decimator.h"
+
+#include <algorithm>
+#include <math.h>
+
+static size_t greatestCommonDivisor(size_t a, size_t b) {
+    while (b) {
+        size_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+// Zeroth order modified Bessel function of the first kind, for the Kaiser window
+static double besselI0(double x) {
+    double sum = 1, term = 1;
+    for (int k=1; k<50 && term > 1e-12 * sum; k++) {
+        term *= (x / (2*k)) * (x / (2*k));
+        sum += term;
+    }
+    return sum;
+}
+
+/* Prototype filter
+ * The output rate is reached by upsampling by L, low-pass filtering at L * inputRate and keeping every M-th sample.
+ * The cutoff lies halfway between the passband edge and outputRate/2, and the Kaiser design formulas give the
+ * window shape for the attenuation and the length for the transition band. The length is rounded up to a whole
+ * number of taps per phase. Output m is sum_k h[p + kL] * x[i - k] for i = floor(mM / L) and p = mM mod L, so phase p
+ * keeps the taps h[p + kL], stored reversed to run forward over the input, and scaled by L for unity gain.
+ */
+PolyphaseDecimator::PolyphaseDecimator(size_t inputRate, size_t outputRate, double passband, double attenuation,
+                                       const mfccKernels<float> &kernels)
+    : inRate(inputRate), outRate(outputRate), kernels(&kernels)
+{
+    size_t g = greatestCommonDivisor(inputRate, outputRate);
+    L = outputRate / g;
+    M = inputRate / g;
+
+    const double pi = 4*atan(1.0);
+    double stopband = outputRate / 2.0;
+    passband = std::min(passband, 0.9 * stopband);
+    double protoRate = double(L) * inputRate;
+    double cutoff = (passband + stopband) / 2 / protoRate;
+    double transition = 2*pi * (stopband - passband) / protoRate;
+
+    double beta = attenuation > 50 ? 0.1102 * (attenuation - 8.7)
+                : attenuation > 21 ? 0.5842 * pow(attenuation - 21, 0.4) + 0.07886 * (attenuation - 21) : 0;
+    size_t length = (size_t) ceil((attenuation - 8) / (2.285 * transition)) + 1;
+    taps = (length + L - 1) / L;
+    length = taps * L;
+
+    std::vector<double> h(length);
+    double sum = 0;
+    for (size_t n=0; n<length; n++) {
+        double t = n - (length - 1) / 2.0;
+        double r = 2 * t / (length - 1);
+        double sinc = t == 0 ? 2*cutoff : sin(2*pi*cutoff*t) / (pi*t);
+        h[n] = sinc * besselI0(beta * sqrt(std::max(0.0, 1 - r*r))) / besselI0(beta);
+        sum += h[n];
+    }
+
+    phases.assign(L * taps, 0);
+    for (size_t p=0; p<L; p++)
+        for (size_t j=0; j<taps; j++)
+            phases[p*taps + j] = float(L * h[p + (taps - 1 - j)*L] / sum);
+
+    reset();
+}
+
+void PolyphaseDecimator::reset() {
+    history.assign(taps - 1, 0);
+    base = 0;
+    nextIndex = taps - 1;
+    nextPhase = 0;
+}
+
+void PolyphaseDecimator::process(const int16_t* samples, size_t n, std::vector<int16_t> &out) {
+    size_t first = history.size();
+    history.resize(first + n);
+    for (size_t i=0; i<n; i++)
+        history[first + i] = samples[i];
+
+    size_t end = base + history.size();
+    while (nextIndex < end) {
+        const float* x = &history[nextIndex + 1 - taps - base];
+        float y = kernels->dot(&phases[nextPhase * taps], x, taps);
+        y = y < -32768.0f ? -32768.0f : (y > 32767.0f ? 32767.0f : y);
+        out.push_back(int16_t(lrintf(y)));
+
+        nextPhase += M;
+        nextIndex += nextPhase / L;
+        nextPhase %= L;
+    }
+
+    // Keep the taps - 1 samples in front of the next output
+    size_t keep = nextIndex + 1 - taps;
+    if (keep > base) {
+        size_t drop = std::min(keep - base, history.size());
+        history.erase(history.begin(), history.begin() + drop);
+        base += drop;
+    }
+}
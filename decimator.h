@@ -0,0 +1,53 @@
+#ifndef DECIMATOR
+#define DECIMATOR
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "simdkernels.h"
+
+/**
+ * Streaming polyphase anti-aliasing decimator from inputRate to a lower outputRate, for any rational ratio L/M of the
+ * two rates such as 16000/44100 = 160/441. The prototype is a Kaiser-windowed sinc low-pass that passes up to passband
+ * Hz and reaches attenuation dB at outputRate/2. Only the taps that meet an input sample are evaluated: every output
+ * sample is one dot product of tapsPerPhase() coefficients of one of the L phases with contiguous input samples,
+ * which runs on the SIMD dot kernel.
+ *
+ * Samples can be pushed in chunks of any size. The output is delayed by delay() output samples, a fraction of a
+ * millisecond, and the last of them only leave the filter with the next chunk.
+ */
+class PolyphaseDecimator
+{
+public:
+    PolyphaseDecimator(size_t inputRate = 44100, size_t outputRate = 16000, double passband = 4000,
+                       double attenuation = 80, const mfccKernels<float> &kernels = mfccKernelsDetected<float>());
+
+    size_t inputRate() const { return inRate; }
+    size_t outputRate() const { return outRate; }
+    size_t tapsPerPhase() const { return taps; }
+    double delay() const { return (double(taps) * L - 1) / (2.0 * M); }
+
+    // Start a new stream, the samples before it are zero
+    void reset();
+    // Filter n more input samples and append the completed output samples to out
+    void process(const int16_t* samples, size_t n, std::vector<int16_t> &out);
+
+private:
+    size_t                      inRate;
+    size_t                      outRate;
+    size_t                      L;                  // outputRate / gcd
+    size_t                      M;                  // inputRate / gcd
+    size_t                      taps;
+    const mfccKernels<float>*   kernels;
+
+    std::vector<float>          phases;             // L phases of taps coefficients each, reversed and scaled by L
+
+    // Input samples from index base on, the first taps - 1 indices are the zeros in front of the stream
+    std::vector<float>          history;
+    size_t                      base;
+    size_t                      nextIndex;          // Newest input sample of the next output sample
+    size_t                      nextPhase;
+};
+
+#endif // DECIMATOR
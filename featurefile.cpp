@@ -0,0 +1,234 @@
+#include "featurefile.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QDebug>
+#include <QtEndian>
+
+struct FeatureFileHeader
+{
+    char        magic[4];           // "MFCF"
+    quint32     version;            // 1
+    quint32     byteOrder;          // 0x01020304 in the byte order of the writer, the values are stored in it too
+    quint32     dims;               // Values per frame
+    quint64     numFrames;
+    quint64     framesOffset;       // Byte offset of frame 0, page aligned
+    quint32     sampleRate;
+    quint32     numCepstral;
+    quint32     numFilters;
+    quint32     numFFT;
+    quint32     winWidth;
+    quint32     frameShift;
+    double      lowFreq;
+    double      highFreq;
+    quint32     deltaOrder;
+    quint32     spectralFeatures;
+};
+
+static const quint32 featureFileVersion = 1;
+static const quint32 featureFileByteOrder = 0x01020304;
+static const quint64 featureFileFramesOffset = 4096;
+
+// HTK parameter kinds and qualifiers
+static const quint16 htkMfcc = 6;
+static const quint16 htkUser = 9;
+static const quint16 htkDelta = 0x100;
+static const quint16 htkAcceleration = 0x200;
+static const quint16 htkC0 = 0x2000;
+
+FeatureFile::FeatureFile(QObject *parent)
+    : QFile(parent)
+    , m_map(0)
+    , m_numFrames(0)
+    , m_framesOffset(0)
+{
+    memset(&m_info, 0, sizeof(m_info));
+}
+
+FeatureFile::~FeatureFile()
+{
+    close();
+}
+
+bool FeatureFile::open(const QString &fileName)
+{
+    close();
+    setFileName(fileName);
+    if (!QFile::open(QIODevice::ReadOnly) || !readHeader())
+        return false;
+
+    // A file without frames has nothing to map
+    if (m_numFrames == 0)
+        return true;
+    m_map = map(0, QFile::size());
+    return m_map != 0;
+}
+
+void FeatureFile::close()
+{
+    if (m_map)
+        unmap(m_map);
+    m_map = 0;
+    m_numFrames = 0;
+    QFile::close();
+}
+
+bool FeatureFile::readHeader()
+{
+    seek(0);
+    FeatureFileHeader header;
+    if (read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header))
+        return false;
+    if (memcmp(header.magic, "MFCF", 4) != 0 || header.version != featureFileVersion) {
+        qDebug() << "Not a feature file:" << fileName();
+        return false;
+    }
+    if (header.byteOrder != featureFileByteOrder || header.dims == 0) {
+        qDebug() << "Feature file written with another byte order:" << fileName();
+        return false;
+    }
+
+    // A file without frames may end with the header, before the frames offset
+    quint64 length = header.framesOffset + header.numFrames * header.dims * sizeof(float);
+    if (header.numFrames > 0 && (quint64) QFile::size() < length) {
+        qDebug() << "Feature file is truncated:" << fileName();
+        return false;
+    }
+
+    m_numFrames = header.numFrames;
+    m_framesOffset = header.framesOffset;
+    m_info.config.fs = header.sampleRate;
+    m_info.config.numCepstral = header.numCepstral;
+    m_info.config.numFilters = header.numFilters;
+    m_info.config.numFFT = header.numFFT;
+    m_info.config.winWidth = header.winWidth;
+    m_info.config.frameShift = header.frameShift;
+    m_info.config.lowFreq = header.lowFreq;
+    m_info.config.highFreq = header.highFreq;
+    m_info.dims = header.dims;
+    m_info.deltaOrder = header.deltaOrder;
+    m_info.spectralFeatures = header.spectralFeatures;
+    return true;
+}
+
+// ***** Writer *****
+
+FeatureFileWriter::FeatureFileWriter()
+    : format(NativeFeatureFile), buffered(0), numFrames(0), failed(false)
+{
+    memset(&info, 0, sizeof(info));
+}
+
+FeatureFileWriter::~FeatureFileWriter()
+{
+    if (file.isOpen())
+        close();
+}
+
+bool FeatureFileWriter::open(const QString &fileName, const FeatureFileInfo &info, FeatureFileFormat format) {
+    if (file.isOpen())
+        close();
+    this->info = info;
+    this->format = format;
+    buffered = 0;
+    numFrames = 0;
+    failed = false;
+
+    // About 4 MB of whole frames per block
+    size_t blockFrames = std::max((size_t) (1 << 20) / std::max(info.dims, (size_t) 1), (size_t) 1);
+    buffer.assign(blockFrames * info.dims, 0);
+
+    file.setFileName(fileName);
+    if (info.dims == 0 || !file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Unable to write feature file:" << fileName;
+        return false;
+    }
+    if (!writeHeader()) {
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+void FeatureFileWriter::write(const double* frame) {
+    float* dst = &buffer[buffered];
+    size_t dims = info.dims;
+    size_t cepstra = info.config.numCepstral;
+    if (format == HtkFeatureFile && info.spectralFeatures == 0) {
+        // C0 behind c1 .. cN in the static block and in each delta block
+        for (size_t b=0; b<dims; b+=cepstra+1) {
+            for (size_t i=0; i<cepstra; i++)
+                dst[b + i] = float(frame[b + i + 1]);
+            dst[b + cepstra] = float(frame[b]);
+        }
+    } else {
+        for (size_t i=0; i<dims; i++)
+            dst[i] = float(frame[i]);
+    }
+    if (format == HtkFeatureFile) {
+        for (size_t i=0; i<dims; i++) {
+            quint32 bits;
+            memcpy(&bits, &dst[i], sizeof(bits));
+            bits = qToBigEndian(bits);
+            memcpy(&dst[i], &bits, sizeof(bits));
+        }
+    }
+
+    buffered += dims;
+    numFrames++;
+    if (buffered == buffer.size())
+        flush();
+}
+
+bool FeatureFileWriter::flush() {
+    qint64 bytes = buffered * sizeof(float);
+    if (bytes > 0 && file.write(reinterpret_cast<const char *>(buffer.data()), bytes) != bytes)
+        failed = true;
+    buffered = 0;
+    return !failed;
+}
+
+bool FeatureFileWriter::writeHeader() {
+    if (format == HtkFeatureFile) {
+        // nSamples, sampPeriod in 100 ns units, sampSize in bytes and parmKind, all big-endian
+        quint16 kind = info.spectralFeatures ? htkUser : htkMfcc | htkC0;
+        if (!info.spectralFeatures && info.deltaOrder >= 1)
+            kind |= htkDelta;
+        if (!info.spectralFeatures && info.deltaOrder >= 2)
+            kind |= htkAcceleration;
+        uchar header[12];
+        qToBigEndian<quint32>(numFrames, header);
+        qToBigEndian<quint32>(info.config.frameShift * 10000, header + 4);
+        qToBigEndian<quint16>(info.dims * sizeof(float), header + 8);
+        qToBigEndian<quint16>(kind, header + 10);
+        return file.seek(0) && file.write(reinterpret_cast<const char *>(header), sizeof(header)) == sizeof(header);
+    }
+
+    FeatureFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "MFCF", 4);
+    header.version = featureFileVersion;
+    header.byteOrder = featureFileByteOrder;
+    header.dims = info.dims;
+    header.numFrames = numFrames;
+    header.framesOffset = featureFileFramesOffset;
+    header.sampleRate = info.config.fs;
+    header.numCepstral = info.config.numCepstral;
+    header.numFilters = info.config.numFilters;
+    header.numFFT = info.config.numFFT;
+    header.winWidth = info.config.winWidth;
+    header.frameShift = info.config.frameShift;
+    header.lowFreq = info.config.lowFreq;
+    header.highFreq = info.config.highFreq;
+    header.deltaOrder = info.deltaOrder;
+    header.spectralFeatures = info.spectralFeatures;
+    return file.seek(0) && file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == sizeof(header)
+           && file.seek(featureFileFramesOffset);
+}
+
+bool FeatureFileWriter::close() {
+    bool ok = flush() && writeHeader();
+    file.close();
+    return ok;
+}
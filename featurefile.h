@@ -0,0 +1,91 @@
+#ifndef FEATUREFILE
+#define FEATUREFILE
+
+#include <QFile>
+
+#include <vector>
+
+#include "mfccextractor.h"
+
+// Layout of a feature file written by FeatureFileWriter
+enum FeatureFileFormat {
+    NativeFeatureFile,          // Header of the configuration, float32 frames in the byte order of the writer
+    HtkFeatureFile              // HTK parameter file, big-endian, readable by HTK and the tools built on its format
+};
+
+// What the frames of a feature file hold
+struct FeatureFileInfo {
+    MfccConfig  config;
+    size_t      dims;                   // Values per frame
+    size_t      deltaOrder;             // 0 static features only, 1 with deltas, 2 with deltas and delta-deltas
+    unsigned    spectralFeatures;       // SpectralFeature flags following the MFCCs of the static features
+};
+
+/**
+ * Binary feature file, the compact replacement of the scientific text of SelfSimilarity::process. The file holds a
+ * header with the configuration and the number of frames, and from a page aligned offset on the frames as
+ * contiguous rows of dims float32 values, 4 bytes per value instead of about 14 characters.
+ *
+ * The reader maps the file, frame() points straight into the mapping and nothing is copied or parsed.
+ */
+class FeatureFile : public QFile
+{
+public:
+    FeatureFile(QObject *parent = 0);
+    ~FeatureFile();
+
+    using QFile::open;
+    bool open(const QString &fileName);
+    void close();
+
+    size_t numFrames() const { return m_numFrames; }
+    size_t dims() const { return m_info.dims; }
+    const FeatureFileInfo& info() const { return m_info; }
+
+    // All frames, frame i starting at i * dims()
+    const float* data() const { return reinterpret_cast<const float*>(m_map + m_framesOffset); }
+    const float* frame(size_t i) const { return data() + i * m_info.dims; }
+
+private:
+    bool readHeader();
+
+    uchar*          m_map;
+    size_t          m_numFrames;
+    qint64          m_framesOffset;
+    FeatureFileInfo m_info;
+};
+
+/* Feature file writer
+ * Frames are converted to float32 into a buffer of a few MB and written in blocks of that size, the header is
+ * written again with the number of frames on close(). In HTK files the MFCC kind is MFCC_0 with _D and _A for the
+ * deltas, and C0 moves behind the cepstra of every block as HTK expects; with spectral features appended the kind is
+ * USER and the values keep their order.
+ */
+class FeatureFileWriter
+{
+public:
+    FeatureFileWriter();
+    ~FeatureFileWriter();
+
+    bool open(const QString &fileName, const FeatureFileInfo &info, FeatureFileFormat format = NativeFeatureFile);
+    // Append a frame of info.dims values
+    void write(const double* frame);
+    // Write the remaining frames and the header, false if any write failed
+    bool close();
+
+    size_t size() const { return numFrames; }
+
+private:
+    bool flush();
+    bool writeHeader();
+
+    QFile               file;
+    FeatureFileInfo     info;
+    FeatureFileFormat   format;
+    std::vector<float>  buffer;
+    size_t              buffered;
+    size_t              numFrames;
+    bool                failed;
+};
+
+#endif // FEATUREFILE
@@ -0,0 +1,124 @@
+#include "fftplan.h"
+
+#include <math.h>
+
+const double PI_FFT = 4*atan(1.0);
+
+// Bit-reversal permutation of n points, n is a power of two
+static void compBitReversal(std::vector<size_t> &table, size_t n) {
+    size_t bits = 0;
+    while (((size_t) 1 << bits) < n)
+        bits++;
+
+    table.assign(n, 0);
+    for (size_t i=0; i<n; i++) {
+        size_t r = 0;
+        for (size_t b=0; b<bits; b++)
+            if (i & ((size_t) 1 << b))
+                r |= (size_t) 1 << (bits - 1 - b);
+        table[i] = r;
+    }
+}
+
+template <typename T>
+FFTPlan<T>::FFTPlan(size_t N) : m_size(0)
+{
+    if (N > 0)
+        init(N);
+}
+
+template <typename T>
+void FFTPlan<T>::init(size_t N) {
+    m_size = N;
+    compBitReversal(m_bitrev, N);
+    compBitReversal(m_bitrevHalf, N/2);
+
+    // Twiddle factors of the full size, computed in double and rounded once, smaller stages read them with a stride
+    m_twiddle.assign(N/2, 0);
+    for (size_t k=0; k<N/2; k++)
+        m_twiddle[k] = std::complex<T>(cos(2*PI_FFT*k/N), -sin(2*PI_FFT*k/N));
+}
+
+/* Iterative Cooley-Tukey butterflies
+ * The input is reordered by the bit-reversal permutation first, then log2(n) stages of butterflies are applied in place.
+ * A stage of length len needs the twiddles exp(-2*pi*i*k/len), which are every (N/len)-th entry of the full-size table.
+ * The complex products are spelled out on real and imaginary parts to keep the compiler away from the slow,
+ * NaN-checking library multiplication.
+ */
+template <typename T>
+void FFTPlan<T>::butterflies(std::complex<T>* x, size_t n, const size_t* bitrev) const {
+    for (size_t i=0; i<n; i++) {
+        size_t j = bitrev[i];
+        if (i < j)
+            std::swap(x[i], x[j]);
+    }
+
+    const std::complex<T>* tw = m_twiddle.data();
+    for (size_t len=2; len<=n; len*=2) {
+        size_t half = len / 2;
+        size_t stride = m_size / len;
+        for (size_t i=0; i<n; i+=len) {
+            std::complex<T>* a = x + i;
+            std::complex<T>* b = x + i + half;
+            for (size_t k=0; k<half; k++) {
+                const std::complex<T> w = tw[k*stride];
+                T vr = b[k].real() * w.real() - b[k].imag() * w.imag();
+                T vi = b[k].real() * w.imag() + b[k].imag() * w.real();
+                T ur = a[k].real();
+                T ui = a[k].imag();
+                a[k] = std::complex<T>(ur + vr, ui + vi);
+                b[k] = std::complex<T>(ur - vr, ui - vi);
+            }
+        }
+    }
+}
+
+template <typename T>
+void FFTPlan<T>::transform(std::complex<T>* x) const {
+    butterflies(x, m_size, m_bitrev.data());
+}
+
+/* Real-input transform
+ * The N real samples are packed into N/2 complex values z[k] = x[2k] + i*x[2k+1] and transformed with an N/2-point FFT.
+ * The spectrum of the even and odd samples is then separated as E[k] = (Z[k] + Z*[N/2-k]) / 2 and
+ * O[k] = -i * (Z[k] - Z*[N/2-k]) / 2, and recombined as X[k] = E[k] + exp(-2*pi*i*k/N) * O[k].
+ * Bins k and N/2-k only depend on each other, so the split is done pairwise in place in the output buffer.
+ */
+template <typename T>
+void FFTPlan<T>::transformReal(const T* in, std::complex<T>* out) const {
+    size_t half = m_size / 2;
+    for (size_t k=0; k<half; k++)
+        out[k] = std::complex<T>(in[2*k], in[2*k+1]);
+
+    butterflies(out, half, m_bitrevHalf.data());
+
+    const std::complex<T>* tw = m_twiddle.data();
+    T z0r = out[0].real();
+    T z0i = out[0].imag();
+    out[0] = std::complex<T>(z0r + z0i, 0);
+    out[half] = std::complex<T>(z0r - z0i, 0);
+
+    for (size_t k=1; k<=half/2; k++) {
+        size_t m = half - k;
+        T ar = out[k].real(), ai = out[k].imag();
+        T br = out[m].real(), bi = out[m].imag();
+
+        // Bin k
+        T er = T(0.5) * (ar + br), ei = T(0.5) * (ai - bi);
+        T or_ = T(0.5) * (ai + bi), oi = T(-0.5) * (ar - br);
+        T wr = tw[k].real(), wi = tw[k].imag();
+        std::complex<T> xk(er + wr * or_ - wi * oi, ei + wr * oi + wi * or_);
+
+        // Bin N/2-k, where the roles of Z[k] and Z[N/2-k] are swapped
+        er = T(0.5) * (br + ar); ei = T(0.5) * (bi - ai);
+        or_ = T(0.5) * (bi + ai); oi = T(-0.5) * (br - ar);
+        wr = tw[m].real(); wi = tw[m].imag();
+        std::complex<T> xm(er + wr * or_ - wi * oi, ei + wr * oi + wi * or_);
+
+        out[k] = xk;
+        out[m] = xm;
+    }
+}
+
+template class FFTPlan<float>;
+template class FFTPlan<double>;
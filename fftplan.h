@@ -0,0 +1,37 @@
+#ifndef FFTPLAN
+#define FFTPLAN
+
+#include <complex>
+#include <vector>
+
+/**
+ * Reusable radix-2 FFT plan. The bit-reversal permutation and the twiddle factors
+ * are computed once for a given transform size and kept in flat tables, so every
+ * transform afterwards runs iteratively and in place without touching the heap.
+ * Instantiated for float and double samples.
+ */
+template <typename T>
+class FFTPlan
+{
+public:
+    FFTPlan(size_t N = 0);
+
+    // Precompute the tables for an N-point transform (N must be a power of two).
+    void init(size_t N);
+    size_t size() const { return m_size; }
+
+    // Complex forward transform of N points, in place.
+    void transform(std::complex<T>* x) const;
+    // Real-input forward transform: N real samples in, N/2+1 complex bins out.
+    void transformReal(const T* in, std::complex<T>* out) const;
+
+private:
+    void butterflies(std::complex<T>* x, size_t n, const size_t* bitrev) const;
+
+    size_t                          m_size;
+    std::vector<size_t>             m_bitrev;       // Bit-reversal permutation of N points
+    std::vector<size_t>             m_bitrevHalf;   // Bit-reversal permutation of N/2 points (real-input path)
+    std::vector<std::complex<T>>    m_twiddle;      // exp(-2*pi*i*k/N) for k = 0 .. N/2-1
+};
+
+#endif // FFTPLAN
@@ -0,0 +1,394 @@
+#include "fixedpointmfcc.h"
+
+#include <algorithm>
+#include <math.h>
+
+/* Fixed-point formats
+ * Qn stores x as round(x * 2^n). Tables are Q15 (filter weights), Q16 (pre-emphasis) or Q30 (window, twiddles, DCT),
+ * logs and MFCCs are Q16. The spectrum is kept as int32 with a block exponent shared by all bins: before each
+ * FFT stage the block is shifted just enough to leave the headroom the stage needs, so quiet and loud frames
+ * keep the same ~29 bits of precision.
+ */
+
+const double PI_FIXED = 4*atan(1.0);
+
+// ln(2) in Q30
+const int64_t LN2_Q30 = 744261118;
+
+// Largest magnitude a butterfly stage may read, a radix-2 stage grows a component by at most 1 + sqrt(2)
+const int32_t FFT_STAGE_LIMIT = 1 << 29;
+// Largest magnitude the real-input split may read, it grows a component by at most 2 + 2*sqrt(2)
+const int32_t FFT_SPLIT_LIMIT = 1 << 28;
+
+// Position of the highest set bit, x > 0
+static inline int highestBit(uint64_t x) {
+    return 63 - __builtin_clzll(x);
+}
+
+// Round to nearest and shift right by s > 0
+static inline int32_t roundShift(int64_t x, int s) {
+    return (int32_t) ((x + ((int64_t) 1 << (s - 1))) >> s);
+}
+
+// Q30 product of a sample and a twiddle
+static inline int32_t mulQ30(int64_t a, int64_t b, int64_t c, int64_t d) {
+    return (int32_t) ((a * b + c * d + (1 << 29)) >> 30);
+}
+
+/* Rescale a block of int32 values so that its largest magnitude is at most limit
+ * bits is the bitwise OR of all magnitudes, which has the same highest bit as the maximum. Blocks far below the
+ * limit are shifted up to regain precision. Returns the change of the block exponent.
+ */
+static int normaliseBlock(int32_t* x, size_t n, uint32_t bits, int32_t limit) {
+    if (bits == 0)
+        return 0;
+    int shift = highestBit(limit) - 1 - highestBit(bits);
+    if (shift > 0) {
+        for (size_t i=0; i<n; i++)
+            x[i] = (int32_t) ((uint32_t) x[i] << shift);
+        return -shift;
+    }
+    if (shift < 0) {
+        for (size_t i=0; i<n; i++)
+            x[i] = roundShift(x[i], -shift);
+        return -shift;
+    }
+    return 0;
+}
+
+// Bitwise OR of the magnitudes of a block
+static uint32_t magnitudeBits(const int32_t* x, size_t n) {
+    uint32_t bits = 0;
+    for (size_t i=0; i<n; i++)
+        bits |= (uint32_t) std::abs(x[i]);
+    return bits;
+}
+
+FixedPointMfcc::FixedPointMfcc(size_t fs, size_t numCepstral, size_t numFilters, size_t numFFT,
+                               size_t winWidth, size_t frameShift, double lowFreq, double highFreq)
+{
+    MfccConfig config = { fs, numCepstral, numFilters, numFFT, winWidth, frameShift, lowFreq, highFreq };
+    configure(config);
+}
+
+void FixedPointMfcc::configure(const MfccConfig &config) {
+    configuration = config;
+    fs = config.fs;                     // Sampling rate in Hertz
+    numCepstral = config.numCepstral;   // Number of output cepstra, excluding log-energy
+    numFilters = config.numFilters;     // Number of Mel warped filters in filterbank
+    numFFT = config.numFFT;             // N-point FFT on each frame, a power of two
+    preEmphCoef = 63570;                // Pre-emphasis coefficient 0.97 in Q16
+
+    winWidthSamples = config.winWidth * fs / 1000;
+    frameShiftSamples = config.frameShift * fs / 1000;
+    numWindowSamples = std::min(winWidthSamples, numFFT);
+
+    window.assign(winWidthSamples, 0);
+    spectrum.assign(numFFT + 2, 0);
+    spectrumExp = 0;
+    powerExp = 0;
+
+    // The filterbank ends at fs/2 at most, like the one of MfccExtractor
+    initTables(config.lowFreq, std::min(config.highFreq, fs / 2.0));
+
+    powerSpectralCoef.assign(numFilterBins, 0);
+    lmfbCoef.assign(numFilters, 0);
+    mfcc.assign(numCepstral+1, 0);
+}
+
+void FixedPointMfcc::setOverlap(const int16_t* samples) {
+    std::copy(samples, samples + overlapSamples(), window.begin());
+}
+
+// Process each frame and return Q16 MFCCs, no memory is allocated per frame
+const std::vector<int32_t>& FixedPointMfcc::processFrame(const int16_t* samples) {
+    size_t overlap = overlapSamples();
+    std::copy(samples, samples + frameShiftSamples, window.begin() + overlap);
+
+    preEmphHamming();
+    compPowerSpec();
+    applyLogMelFilterbank();
+    applyDct();
+
+    // Keep the tail of the window as the overlap of the next frame
+    std::copy(window.begin() + frameShiftSamples, window.end(), window.begin());
+
+    return mfcc;
+}
+
+// Process consecutive frames, only the output vectors are allocated
+void FixedPointMfcc::processBlock(const int16_t* samples, size_t numFrames, std::vector<std::vector<double>> &mfccs) {
+    const double scale = 1.0 / (1 << mfccFracBits);
+    for (size_t k=0; k<numFrames; k++, samples += frameShiftSamples) {
+        const std::vector<int32_t> &coef = processFrame(samples);
+        mfccs.emplace_back(coef.size());
+        std::vector<double> &out = mfccs.back();
+        for (size_t i=0; i<coef.size(); i++)
+            out[i] = coef[i] * scale;
+    }
+}
+
+/* Pre-emphasis and Hamming window
+ * y(t) = x(t) - 0.97 x(t-1) is formed in Q16, multiplied by the Q30 window and stored in Q13, which keeps the
+ * largest possible value of a 16-bit input below 2^29. The window needs the Q30 precision: its rounding error
+ * leaks the loud bins into the quiet low ones, which pre-emphasis leaves some 80 dB down. Only the samples that reach the FFT are processed, the
+ * rest of the FFT input is zero padding. The N real samples are the interleaved input of the N/2-point complex FFT.
+ */
+void FixedPointMfcc::preEmphHamming(void) {
+    int32_t* out = spectrum.data();
+    int64_t prev = 0;
+    for (size_t i=0; i<numWindowSamples; i++) {
+        int64_t x = window[i];
+        int64_t y = x * 65536 - (i > 0 ? preEmphCoef * prev : 0);
+        out[i] = roundShift(y * hamming[i], 33);
+        prev = x;
+    }
+    std::fill(spectrum.begin() + numWindowSamples, spectrum.end(), 0);
+    spectrumExp = -13;
+}
+
+/* Power spectrum computation
+ * The real-input FFT of FFTPlan, in fixed point: an N/2-point complex FFT on the packed samples, then the split into
+ * the spectra of the even and odd samples. The split is done without its factor 1/2, which is folded into the block
+ * exponent. The bins below the last filter are then rescaled to 30 bits, so that their squares add up in int64.
+ */
+void FixedPointMfcc::compPowerSpec(void) {
+    size_t half = numFFT / 2;
+    int32_t* z = spectrum.data();
+
+    spectrumExp += normaliseBlock(z, numFFT, magnitudeBits(z, numFFT), FFT_STAGE_LIMIT);
+    fft();
+    spectrumExp += normaliseBlock(z, numFFT, magnitudeBits(z, numFFT), FFT_SPLIT_LIMIT);
+
+    int32_t z0r = z[0], z0i = z[1];
+    z[0] = 2 * (z0r + z0i);
+    z[1] = 0;
+    z[2*half] = 2 * (z0r - z0i);
+    z[2*half+1] = 0;
+
+    const int32_t* tw = twiddle.data();
+    for (size_t k=1; k<=half/2; k++) {
+        size_t m = half - k;
+        int32_t ar = z[2*k], ai = z[2*k+1];
+        int32_t br = z[2*m], bi = z[2*m+1];
+
+        // Bin k, twice E[k] + W^k O[k]
+        int32_t er = ar + br, ei = ai - bi;
+        int32_t or_ = ai + bi, oi = br - ar;
+        int32_t xkr = er + mulQ30(tw[2*k], or_, -tw[2*k+1], oi);
+        int32_t xki = ei + mulQ30(tw[2*k], oi, tw[2*k+1], or_);
+
+        // Bin N/2-k, where the roles of Z[k] and Z[N/2-k] are swapped
+        er = br + ar; ei = bi - ai;
+        or_ = bi + ai; oi = ar - br;
+        int32_t xmr = er + mulQ30(tw[2*m], or_, -tw[2*m+1], oi);
+        int32_t xmi = ei + mulQ30(tw[2*m], oi, tw[2*m+1], or_);
+
+        z[2*k] = xkr; z[2*k+1] = xki;
+        z[2*m] = xmr; z[2*m+1] = xmi;
+    }
+    spectrumExp -= 1;
+
+    size_t n = 2 * numFilterBins;
+    spectrumExp += normaliseBlock(z, n, magnitudeBits(z, n), 1 << 30);
+    for (size_t i=0; i<numFilterBins; i++) {
+        int64_t re = z[2*i], im = z[2*i+1];
+        powerSpectralCoef[i] = re * re + im * im;
+    }
+    powerExp = 2 * spectrumExp;
+}
+
+/* Iterative radix-2 FFT of N/2 points on the interleaved int32 spectrum
+ * Same structure as FFTPlan::butterflies. The magnitudes written by a stage are ORed together, and the block is
+ * shifted down before the next stage whenever they could overflow it.
+ */
+void FixedPointMfcc::fft(void) {
+    size_t n = numFFT / 2;
+    int32_t* x = spectrum.data();
+
+    for (size_t i=0; i<n; i++) {
+        size_t j = bitrev[i];
+        if (i < j) {
+            std::swap(x[2*i], x[2*j]);
+            std::swap(x[2*i+1], x[2*j+1]);
+        }
+    }
+
+    const int32_t* tw = twiddle.data();
+    for (size_t len=2; len<=n; len*=2) {
+        size_t half = len / 2;
+        size_t stride = numFFT / len;
+        uint32_t bits = 0;
+        for (size_t i=0; i<n; i+=len) {
+            int32_t* a = x + 2*i;
+            int32_t* b = x + 2*(i + half);
+            for (size_t k=0; k<half; k++) {
+                int32_t wr = tw[2*k*stride], wi = tw[2*k*stride+1];
+                int32_t vr = mulQ30(b[2*k], wr, -b[2*k+1], wi);
+                int32_t vi = mulQ30(b[2*k], wi, b[2*k+1], wr);
+                int32_t ur = a[2*k], ui = a[2*k+1];
+                a[2*k] = ur + vr; a[2*k+1] = ui + vi;
+                b[2*k] = ur - vr; b[2*k+1] = ui - vi;
+                bits |= (uint32_t) std::abs(a[2*k]) | (uint32_t) std::abs(a[2*k+1])
+                      | (uint32_t) std::abs(b[2*k]) | (uint32_t) std::abs(b[2*k+1]);
+            }
+        }
+        if (len < n && bits >= (uint32_t) FFT_STAGE_LIMIT) {
+            int shift = highestBit(bits) - highestBit(FFT_STAGE_LIMIT) + 1;
+            for (size_t i=0; i<2*n; i++)
+                x[i] = roundShift(x[i], shift);
+            spectrumExp += shift;
+        }
+    }
+}
+
+/* Log Mel filterbank
+ * The power spectrum is shifted down until the widest filter's sum of Q15 weights times the largest bin fits in
+ * int64. The energies are then floored at 1 and their log is taken from the table, with the block exponent added
+ * to the log.
+ */
+void FixedPointMfcc::applyLogMelFilterbank(void) {
+    uint64_t bits = 0;
+    for (size_t i=0; i<numFilterBins; i++)
+        bits |= (uint64_t) powerSpectralCoef[i];
+
+    int shift = 0;
+    if (bits != 0)
+        shift = std::max(0, highestBit(bits) + 1 + filterHeadroomBits - 62);
+
+    for (size_t i=0; i<numFilters; i++) {
+        const int32_t* w = &fbankWeights[fbankOffset[i]];
+        int64_t energy = 0;
+        for (size_t bin=fbankFirstBin[i]; bin<=fbankLastBin[i]; bin++, w++)
+            energy += *w * (powerSpectralCoef[bin] >> shift);
+
+        // Apply Mel-flooring, energies below 1 have a negative log
+        int64_t logEnergy = 0;
+        if (energy > 0)
+            logEnergy = std::max((int64_t) 0, log2Q16(energy) + (int64_t) (powerExp + shift - 15) * 65536);
+        lmfbCoef[i] = (int32_t) ((logEnergy * LN2_Q30 + (1 << 29)) >> 30);
+    }
+}
+
+// Discrete cosine transform, Q30 coefficients times Q16 logs accumulated in int64
+void FixedPointMfcc::applyDct(void) {
+    for (size_t i=0; i<=numCepstral; i++) {
+        const int32_t* c = &dct[i*numFilters];
+        int64_t acc = 0;
+        for (size_t j=0; j<numFilters; j++)
+            acc += (int64_t) c[j] * lmfbCoef[j];
+        mfcc[i] = (int32_t) ((acc + (1 << 29)) >> 30);
+    }
+}
+
+/* log2 in Q16
+ * The integer part is the position of the highest bit. The next 8 bits of the mantissa index the table of
+ * log2(1 + i/256) and the 16 bits after them interpolate linearly between two entries, which is exact to
+ * about 3e-6 before the Q16 rounding.
+ */
+int32_t FixedPointMfcc::log2Q16(uint64_t x) const {
+    int b = highestBit(x);
+    uint64_t m = x << (63 - b);
+    size_t idx = (m >> 55) & 0xFF;
+    int32_t frac = (int32_t) ((m >> 39) & 0xFFFF);
+    int32_t lo = logTable[idx], hi = logTable[idx+1];
+    return b * 65536 + lo + (((hi - lo) * frac + 32768) >> 16);
+}
+
+// ***** Initialisation routines *****
+
+// Hertz to Mel conversion
+static inline double fixedHz2Mel(double f) {
+    return 2595*std::log10(1 + f/700);
+}
+
+// Mel to Hertz conversion
+static inline double fixedMel2Hz(double m) {
+    return 700*(std::pow(10, m/2595) - 1);
+}
+
+// Precompute the window, FFT, filterbank, log and DCT tables in double and round them once
+void FixedPointMfcc::initTables(double lowFreq, double highFreq) {
+    size_t i, j;
+
+    hamming.assign(numWindowSamples, 0);
+    for (i=0; i<numWindowSamples; i++)
+        hamming[i] = (int32_t) lround(1073741824.0 * (0.54 - 0.46 * cos(2 * PI_FIXED * i / (winWidthSamples-1))));
+
+    size_t half = numFFT / 2;
+    size_t bits = 0;
+    while (((size_t) 1 << bits) < half)
+        bits++;
+    bitrev.assign(half, 0);
+    for (i=0; i<half; i++)
+        for (size_t b=0; b<bits; b++)
+            if (i & ((size_t) 1 << b))
+                bitrev[i] |= (size_t) 1 << (bits - 1 - b);
+
+    twiddle.assign(numFFT, 0);
+    for (size_t k=0; k<half; k++) {
+        twiddle[2*k] = (int32_t) lround(1073741824.0 * cos(2*PI_FIXED*k/numFFT));
+        twiddle[2*k+1] = (int32_t) lround(-1073741824.0 * sin(2*PI_FIXED*k/numFFT));
+    }
+
+    // Banded filterbank, the same triangles as MfccExtractor
+    size_t numFFTBins = half + 1;
+    double lowFreqMel = fixedHz2Mel(lowFreq);
+    double highFreqMel = fixedHz2Mel(highFreq);
+    std::vector<double> filterCentreFreq(numFilters+2);
+    for (i=0; i<numFilters+2; i++)
+        filterCentreFreq[i] = fixedMel2Hz(lowFreqMel + (highFreqMel-lowFreqMel)/(numFilters+1)*i);
+
+    fbankFirstBin.assign(numFilters, 0);
+    fbankLastBin.assign(numFilters, 0);
+    fbankOffset.assign(numFilters, 0);
+    fbankWeights.clear();
+    int64_t widestSum = 1;
+    for (size_t filt=1; filt<=numFilters; filt++) {
+        std::vector<int32_t> ftemp(numFFTBins, 0);
+        for (size_t bin=0; bin<numFFTBins; bin++) {
+            double freq = fs/2.0/(numFFTBins-1)*bin;
+            double weight = 0;
+            if (freq < filterCentreFreq[filt-1])
+                weight = 0;
+            else if (freq <= filterCentreFreq[filt])
+                weight = (freq - filterCentreFreq[filt-1]) / (filterCentreFreq[filt] - filterCentreFreq[filt-1]);
+            else if (freq <= filterCentreFreq[filt+1])
+                weight = (filterCentreFreq[filt+1] - freq) / (filterCentreFreq[filt+1] - filterCentreFreq[filt]);
+            ftemp[bin] = (int32_t) lround(32768 * weight);
+        }
+
+        size_t first = 0, last = 0;
+        while (first < numFFTBins && ftemp[first] == 0)
+            first++;
+        if (first == numFFTBins)
+            first = 0;      // Filter narrower than one bin, keep a single zero weight
+        for (size_t bin=first; bin<numFFTBins; bin++)
+            if (ftemp[bin] != 0)
+                last = bin;
+        if (last < first)
+            last = first;
+
+        int64_t sum = 0;
+        for (size_t bin=first; bin<=last; bin++)
+            sum += ftemp[bin];
+        widestSum = std::max(widestSum, sum);
+
+        fbankFirstBin[filt-1] = first;
+        fbankLastBin[filt-1] = last;
+        fbankOffset[filt-1] = fbankWeights.size();
+        fbankWeights.insert(fbankWeights.end(), ftemp.begin()+first, ftemp.begin()+last+1);
+    }
+    numFilterBins = fbankLastBin.back() + 1;
+    filterHeadroomBits = highestBit(widestSum) + 1;
+
+    logTable.assign(257, 0);
+    for (i=0; i<=256; i++)
+        logTable[i] = (int32_t) lround(65536 * log2(1 + i/256.0));
+
+    dct.assign((numCepstral+1) * numFilters, 0);
+    double c = sqrt(2.0/numFilters);
+    for (i=0; i<=numCepstral; i++)
+        for (j=0; j<numFilters; j++)
+            dct[i*numFilters + j] = (int32_t) lround(1073741824.0 * c * cos(PI_FIXED / numFilters * i * (j + 0.5)));
+}
@@ -0,0 +1,90 @@
+#ifndef FIXEDPOINTMFCC
+#define FIXEDPOINTMFCC
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mfccextractor.h"
+
+/**
+ * Integer-only MFCC extractor for units without a usable FPU. It follows the same pipeline and takes the same
+ * MfccConfig as MfccExtractor: Q16 pre-emphasis and Q30 Hamming window, a radix-2 FFT on int32 data with
+ * Q30 twiddles and block-floating-point scaling, a 64-bit power spectrum and filterbank, a log taken from a
+ * lookup table and a Q30 DCT. The tables are computed once by configure, frame processing only uses
+ * integer arithmetic. It computes the MFCCs alone, without spectral features, deltas or a stream.
+ *
+ * processFrame returns the MFCCs in Q15.16 (divide by 2^mfccFracBits), processBlock converts them to double on
+ * output. Against MfccExtractor<double> on 16-bit noise and tones from 0 to -90 dBFS the error of every
+ * coefficient stays below 3e-3 at 44.1 kHz and below 2e-3 at 16 and 8 kHz; above -40 dBFS it stays below 2e-4
+ * at 16 and 8 kHz. Digital silence gives the same zeros. The error is dominated by filters of little energy: the
+ * narrow low-frequency filters that cover one or two bins at 44.1 kHz, and for quiet input the energies close
+ * to the Mel floor.
+ */
+class FixedPointMfcc
+{
+public:
+    FixedPointMfcc(size_t fs = 44100, size_t numCepstral = 12, size_t numFilters = 40, size_t numFFT = 512,
+                   size_t winWidth = 25, size_t frameShift = 10, double lowFreq = 50, double highFreq = 4000);
+
+    static const int mfccFracBits = 16;
+
+    // Switch to another configuration, numFFT must be a power of two
+    void configure(const MfccConfig &config);
+    const MfccConfig& config() const { return configuration; }
+
+    size_t sampleRate() const { return fs; }
+    size_t numCoefficients() const { return numCepstral + 1; }
+    size_t overlapSamples() const { return winWidthSamples - frameShiftSamples; }
+    size_t shiftSamples() const { return frameShiftSamples; }
+
+    // Set the overlapSamples() samples that precede the first frame
+    void setOverlap(const int16_t* samples);
+    // Add shiftSamples() new samples and return the Q15.16 MFCCs of the completed frame
+    const std::vector<int32_t>& processFrame(const int16_t* samples);
+    // Add numFrames * shiftSamples() new samples and append the MFCCs of every completed frame, in double
+    void processBlock(const int16_t* samples, size_t numFrames, std::vector<std::vector<double>> &mfccs);
+
+private:
+    void preEmphHamming(void);
+    void compPowerSpec(void);
+    void applyLogMelFilterbank(void);
+    void applyDct(void);
+    void fft(void);
+    int32_t log2Q16(uint64_t x) const;
+    void initTables(double lowFreq, double highFreq);
+
+    MfccConfig  configuration;
+    size_t      fs;
+    size_t      numCepstral;
+    size_t      numFilters;
+    size_t      numFFT;
+    size_t      winWidthSamples;
+    size_t      frameShiftSamples;
+    size_t      numWindowSamples;       // Samples of the window that reach the FFT, min(winWidthSamples, numFFT)
+    size_t      numFilterBins;          // FFT bins up to the upper edge of the last filter
+    int         filterHeadroomBits;     // Bits needed by the widest filter's sum of Q15 weights
+    int32_t     preEmphCoef;            // Q16
+
+    std::vector<int16_t>    window;             // Samples of the current frame, the overlap first
+    std::vector<int32_t>    hamming;            // Q30
+    std::vector<int32_t>    spectrum;           // Interleaved (re, im), N/2+1 bins
+    int                     spectrumExp;        // Block exponent, spectrum value = spectrum * 2^spectrumExp
+    std::vector<int64_t>    powerSpectralCoef;
+    int                     powerExp;           // Block exponent of powerSpectralCoef
+
+    std::vector<size_t>     bitrev;             // Bit-reversal permutation of N/2 points
+    std::vector<int32_t>    twiddle;            // Interleaved Q30 exp(-2*pi*i*k/N), k = 0 .. N/2-1
+
+    std::vector<size_t>     fbankFirstBin;
+    std::vector<size_t>     fbankLastBin;
+    std::vector<size_t>     fbankOffset;
+    std::vector<int32_t>    fbankWeights;       // Q15
+
+    std::vector<int32_t>    logTable;           // log2(1 + i/256) in Q16, i = 0 .. 256
+    std::vector<int32_t>    lmfbCoef;           // Natural log in Q16
+    std::vector<int32_t>    dct;                // Q30, (numCepstral+1) x numFilters
+    std::vector<int32_t>    mfcc;               // Q16
+};
+
+#endif // FIXEDPOINTMFCC
@@ -2,6 +2,9 @@
 #include <QQmlApplicationEngine>
 
 #include "paintedlevels.h"
+#include "similarityfile.h"
+#include "similaritymatrix.h"
+#include "similaritypyramid.h"
 
 QString localFile;
 
@@ -10,7 +13,10 @@ QVector<qreal> levelsAll;
 QVector<qreal> levelsSpectrum;
 QVector<qreal> frequenciesSpectrum;
 
-std::vector<double> vecdsimilarity;
+PackedSimilarityMatrix<float> similarityMatrix;
+BandedSimilarityMatrix<float> bandedSimilarity;
+SimilarityFile similarityFile;
+SimilarityPyramid similarityPyramid;
 
 QByteArray bufferUtf8;
 
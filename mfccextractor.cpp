@@ -0,0 +1,670 @@
+#include "mfccextractor.h"
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <tuple>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QStandardPaths>
+
+/* MFCC feature vectors calculation is based on D S Pavan Kumar's MFCC Feature Extractor using C++ STL and C++11. Thank you.
+ * Please check the following github repository: https://github.com/dspavankumar/compute-mfcc.
+ */
+
+const double PI_MFCC = 4*atan(1.0);
+
+// FFTW wisdom file, plans measured once are reused by later runs. All three are only touched under fftwPlannerMutex().
+static QString wisdomPath;
+static bool wisdomPathSet = false;
+static bool fftwWisdomImported = false;
+
+QMutex &fftwPlannerMutex() {
+    static QMutex mutex;
+    return mutex;
+}
+
+// The default is resolved on first use, once the application has set its name
+static QString currentWisdomPath() {
+    if (!wisdomPathSet) {
+        QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+        wisdomPath = dataDir.isEmpty() ? QString() : QDir(dataDir).filePath("fftw.wisdom");
+        wisdomPathSet = true;
+    }
+    return wisdomPath;
+}
+
+void setFftwWisdomPath(const QString &path) {
+    QMutexLocker locker(&fftwPlannerMutex());
+    wisdomPath = path;
+    wisdomPathSet = true;
+    fftwWisdomImported = false;
+}
+
+QString fftwWisdomPath() {
+    QMutexLocker locker(&fftwPlannerMutex());
+    return currentWisdomPath();
+}
+
+template <typename T>
+const size_t MfccExtractor<T>::blockFrames;
+
+template <typename T>
+MfccExtractor<T>::MfccExtractor(size_t fs, size_t numCepstral, size_t numFilters, size_t numFFT,
+                                size_t winWidth, size_t frameShift, double lowFreq, double highFreq)
+{
+    preEmphCoef = 0.97;                 // Pre-emphasis coefficient
+
+    kernels = &mfccKernelsDetected<T>();
+    deltas = DeltaFilter<T>(numCepstral+1, 0, 2, *kernels);
+
+    backend = FFTW;
+    fftwIn = 0;
+    fftwOut = 0;
+
+    MfccConfig config = { fs, numCepstral, numFilters, numFFT, winWidth, frameShift, lowFreq, highFreq };
+    configure(config);
+}
+
+template <typename T>
+MfccExtractor<T>::~MfccExtractor()
+{
+    fftw_free(fftwIn);
+    fftw_free(fftwOut);
+}
+
+/* Configuration
+ * The tables come from the plan cache, only the buffers of this extractor are sized here. The spectral features
+ * and the deltas keep their settings and follow the new configuration.
+ */
+template <typename T>
+void MfccExtractor<T>::configure(const MfccConfig &config) {
+    plan = MfccPlan<T>::get(config);
+    fs = config.fs;
+    numCepstral = config.numCepstral;
+    numFilters = config.numFilters;
+    numFFT = config.numFFT;
+    winWidthSamples = plan->winWidthSamples;
+    frameShiftSamples = plan->frameShiftSamples;
+    numWindowSamples = plan->numWindowSamples;
+    numFFTBins = plan->numFFTBins;
+    numBlockBins = plan->numBlockBins;
+
+    ring.assign(winWidthSamples, 0);
+    ringHead = 0;
+    streamPending.assign(std::max(overlapSamples(), frameShiftSamples), 0);
+    streamFill = 0;
+    streamStarted = false;
+    frame.assign(numWindowSamples, 0);
+    procFrame.assign(numFFT, 0);    // Zero padding beyond numWindowSamples, never written
+    powerSpectralCoef.assign(numFFTBins, 0);
+    spectrum.assign(numFFTBins, 0);
+    lmfbCoef.assign(numFilters, 0);
+
+    blockPower.assign(numBlockBins * blockFrames, 0);
+    blockLmfb.assign(numFilters * blockFrames, 0);
+    blockMfcc.assign((numCepstral+1) * blockFrames, 0);
+
+    fftw_free(fftwIn);
+    fftw_free(fftwOut);
+    fftwIn = (double*)fftw_malloc(sizeof(double) * numFFT);
+    fftwOut = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * numFFTBins);
+
+    setSpectralFeatures(spectral.features());
+}
+
+template <typename T>
+void MfccExtractor<T>::setSampleRate(size_t fs) {
+    MfccConfig config = plan->config;
+    config.fs = fs;
+    configure(config);
+}
+
+// Select the kernels of the MFCC hot loops, mfccKernelsScalar() is the reference for the vectorised ones
+template <typename T>
+void MfccExtractor<T>::setKernels(const mfccKernels<T> &kernels) {
+    this->kernels = &kernels;
+    deltas.setKernels(kernels);
+    spectral.setKernels(kernels);
+}
+
+// Takes effect with the next stream
+template <typename T>
+void MfccExtractor<T>::setDeltaOrder(size_t order, size_t window) {
+    deltas = DeltaFilter<T>(numStaticFeatures(), order, window, *kernels);
+}
+
+// The RMS is corrected for the energy of the part of the window that reaches the FFT, every feature for the
+// pre-emphasis
+template <typename T>
+void MfccExtractor<T>::setSpectralFeatures(unsigned features) {
+    double windowEnergy = 0;
+    for (size_t i=0; i<numWindowSamples; i++)
+        windowEnergy += double(plan->hamming[i]) * plan->hamming[i];
+    spectral = SpectralFeatures<T>(features, fs, numFFT, windowEnergy, preEmphCoef, *kernels);
+
+    mfcc.assign(numStaticFeatures(), 0);
+    blockSpectral.assign(spectral.size() * blockFrames, 0);
+    deltas = DeltaFilter<T>(numStaticFeatures(), deltas.order(), deltas.window(), *kernels);
+}
+
+// Select the FFT used for the power spectrum, both backends give the same coefficients up to rounding
+template <typename T>
+void MfccExtractor<T>::setSpectrumBackend(SpectrumBackend backend) {
+    this->backend = backend;
+}
+
+// The overlap is stored just behind the slot of the first frame's new samples
+template <typename T>
+void MfccExtractor<T>::setOverlap(const int16_t* samples) {
+    std::copy(samples, samples + overlapSamples(), ring.begin() + frameShiftSamples);
+    ringHead = 0;
+    spectral.reset();
+}
+
+/* Framing
+ * The new samples overwrite the oldest ones in the circular buffer, which then holds the whole frame starting at
+ * ringHead. The part of the frame that reaches the FFT is unrolled into frame in at most two contiguous copies,
+ * the samples of the previous frames are never moved.
+ */
+template <typename T>
+void MfccExtractor<T>::pushFrameSamples(const int16_t* samples) {
+    size_t n = std::min(frameShiftSamples, winWidthSamples - ringHead);
+    std::copy(samples, samples + n, ring.begin() + ringHead);
+    std::copy(samples + n, samples + frameShiftSamples, ring.begin());
+    ringHead = (ringHead + frameShiftSamples) % winWidthSamples;
+
+    n = std::min(numWindowSamples, winWidthSamples - ringHead);
+    std::copy(ring.begin() + ringHead, ring.begin() + ringHead + n, frame.begin());
+    std::copy(ring.begin(), ring.begin() + (numWindowSamples - n), frame.begin() + n);
+}
+
+// Process each frame and return MFCCs, the spectral features fan out from the same power spectrum
+template <typename T>
+const std::vector<T>& MfccExtractor<T>::processFrame(const int16_t* samples) {
+    pushFrameSamples(samples);
+    preEmphHamming();
+    compPowerSpec();
+    applyLogMelFilterbank();
+    applyDct();
+    if (spectral.size() > 0)
+        spectral.process(powerSpectralCoef.data(), &mfcc[numCepstral+1]);
+
+    return mfcc;
+}
+
+/* Streaming input
+ * Chunks of any size are accepted. The first overlapSamples() samples of the stream are collected as the overlap,
+ * after that every frameShiftSamples samples complete a frame. Whole frames are processed straight from the chunk,
+ * only a partial frame at either end of a chunk is copied to streamPending. Memory use does not depend on the
+ * length of the stream and nothing is allocated per frame.
+ */
+template <typename T>
+void MfccExtractor<T>::resetStream() {
+    streamFill = 0;
+    streamStarted = false;
+    deltas.reset();
+}
+
+template <typename T>
+void MfccExtractor<T>::emitFrame(const std::vector<T> &mfcc, const FrameCallback &callback) {
+    if (const std::vector<T>* features = deltas.push(mfcc.data()))
+        callback(*features);
+}
+
+template <typename T>
+void MfccExtractor<T>::finishStream(const FrameCallback &callback) {
+    while (const std::vector<T>* features = deltas.flush())
+        callback(*features);
+}
+
+template <typename T>
+void MfccExtractor<T>::pushSamples(const int16_t* samples, size_t n, const FrameCallback &callback) {
+    if (!streamStarted) {
+        size_t take = std::min(n, overlapSamples() - streamFill);
+        std::copy(samples, samples + take, streamPending.begin() + streamFill);
+        streamFill += take;
+        samples += take;
+        n -= take;
+        if (streamFill < overlapSamples())
+            return;
+        setOverlap(streamPending.data());
+        streamFill = 0;
+        streamStarted = true;
+    }
+
+    // Complete the frame left over from the previous chunk
+    if (streamFill > 0) {
+        size_t take = std::min(n, frameShiftSamples - streamFill);
+        std::copy(samples, samples + take, streamPending.begin() + streamFill);
+        streamFill += take;
+        samples += take;
+        n -= take;
+        if (streamFill < frameShiftSamples)
+            return;
+        emitFrame(processFrame(streamPending.data()), callback);
+        streamFill = 0;
+    }
+
+    for (; n >= frameShiftSamples; samples += frameShiftSamples, n -= frameShiftSamples)
+        emitFrame(processFrame(samples), callback);
+
+    std::copy(samples, samples + n, streamPending.begin());
+    streamFill = n;
+}
+
+/* Process a block of consecutive frames
+ * samples holds numFrames * frameShiftSamples new samples, the overlap comes from the circular buffer just like in processFrame.
+ * Framing, windowing and the FFT run frame by frame, the power spectra are collected into a block and the filterbank
+ * and the DCT are then applied to the whole block as matrix-matrix products. The spectral features are taken from
+ * the spectrum of every frame on its way into the block.
+ */
+template <typename T>
+void MfccExtractor<T>::processBlock(const int16_t* samples, size_t numFrames, std::vector<std::vector<T>> &mfccs) {
+    while (numFrames > 0) {
+        size_t K = std::min(numFrames, blockFrames);
+
+        for (size_t k=0; k<K; k++) {
+            pushFrameSamples(samples);
+            samples += frameShiftSamples;
+
+            preEmphHamming();
+            compPowerSpec();
+            for (size_t bin=0; bin<numBlockBins; bin++)
+                blockPower[bin*K + k] = powerSpectralCoef[bin];
+            if (spectral.size() > 0)
+                spectral.process(powerSpectralCoef.data(), &blockSpectral[k*spectral.size()]);
+        }
+
+        applyLogMelFilterbankBlock(K);
+        applyDctBlock(K);
+
+        // The vector of every frame is the only allocation, it is filled in place
+        for (size_t k=0; k<K; k++) {
+            mfccs.emplace_back(numStaticFeatures());
+            std::vector<T> &coef = mfccs.back();
+            for (size_t i=0; i<=numCepstral; i++)
+                coef[i] = blockMfcc[i*K + k];
+            std::copy(blockSpectral.begin() + k*spectral.size(), blockSpectral.begin() + (k+1)*spectral.size(),
+                      coef.begin() + numCepstral + 1);
+        }
+        numFrames -= K;
+    }
+}
+
+// ***** Conversion functions *****
+
+// Hertz to Mel conversion
+inline double Hz2Mel(double f) {
+    return 2595*std::log10(1 + f/700);
+}
+
+// Mel to Hertz conversion
+inline double Mel2Hz(double m) {
+    return 700*(std::pow(10, m/2595) - 1);
+}
+
+// ***** Frame processing routines *****
+
+/* Pre-emphasis and Hamming window
+ * The first step is to apply a pre-emphasis filter on the signal to amplify the high frequencies.
+ * A pre-emphasis filter is useful in several ways: (1) balance the frequency spectrum since high frequencies
+ * usually have smaller magnitudes compared to lower frequencies, (2) avoid numerical problems during the
+ * Fourier transform operation and (3) may also improve the Signal-to-Noise Ratio (SNR).
+ * The pre-emphasis filter can be applied to a signal x using the first order filter in the following equation: y(t)=x(t)−αx(t−1).
+ */
+template <typename T>
+void MfccExtractor<T>::preEmphHamming(void) {
+    kernels->preEmphHamming(frame.data(), plan->hamming.data(), preEmphCoef, procFrame.data(), numWindowSamples);
+}
+
+/* Power spectrum computation
+ * After pre-emphasis, we need to split the signal into short-time frames. We can safely assume that frequencies in a signal
+ * are stationary over a very short period of time. Therefore, by doing a Fourier transform over this short-time frame,
+ * we can obtain a good approximation of the frequency contours of the signal by concatenating adjacent frames.
+ *
+ * We can now do an N-point FFT on each frame to calculate the frequency spectrum, which is also called Short-Time
+ * Fourier-Transform, where N is typically 256 or 512, numFFT = 512 in this case; and then compute the power spectrum (periodogram)
+ * using the following equation: P=|FFT(xi)|^2 where, xi is the ith frame of signal x.
+ * A window longer than numFFT is truncated to its first numFFT samples, a shorter one is zero-padded.
+ */
+template <typename T>
+void MfccExtractor<T>::compPowerSpec(void) {
+    if (backend == FFTW) {
+        std::copy(procFrame.begin(), procFrame.end(), fftwIn);
+        fftw_execute_dft_r2c(plan->fftwPlan, fftwIn, fftwOut);
+        powerSpectrumFFTW();
+        return;
+    }
+
+    plan->fftPlan.transformReal(procFrame.data(), spectrum.data());
+    kernels->powerSpectrum((const T*) spectrum.data(), powerSpectralCoef.data(), numFFTBins);
+}
+
+// Only the double precision libfftw3 is linked, the float extractor rounds its spectrum once here
+template <>
+void MfccExtractor<double>::powerSpectrumFFTW(void) {
+    kernels->powerSpectrum((const double*) fftwOut, powerSpectralCoef.data(), numFFTBins);
+}
+
+template <>
+void MfccExtractor<float>::powerSpectrumFFTW(void) {
+    for (size_t i=0; i<numFFTBins; i++)
+        powerSpectralCoef[i] = fftwOut[i][0] * fftwOut[i][0] + fftwOut[i][1] * fftwOut[i][1];
+}
+
+/* Applying log Mel filterbank
+ * The final step to computing filter banks is applying triangular filters, typically 40 filters, numFilters = 40 on a Mel-scale
+ * to the power spectrum to extract frequency bands. The Mel-scale aims to mimic the non-linear human ear perception of sound,
+ * by being more discriminative at lower frequencies and less discriminative at higher frequencies.
+ */
+template <typename T>
+void MfccExtractor<T>::applyLogMelFilterbank(void) {
+    const melFilterbank<T> &fbank = plan->fbank;
+    for (size_t i=0; i<numFilters; i++) {
+        // Multiply the nonzero band of the filter only
+        const T* w = &fbank.weights[fbank.offset[i]];
+        const T* p = &powerSpectralCoef[fbank.firstBin[i]];
+        size_t width = fbank.lastBin[i] - fbank.firstBin[i] + 1;
+        lmfbCoef[i] = kernels->dot(w, p, width);
+        // Apply Mel-flooring
+        if (lmfbCoef[i] < 1)
+            lmfbCoef[i] = 1;
+    }
+
+    // Applying log on amplitude
+    for (size_t i=0; i<numFilters; i++)
+        lmfbCoef[i] = std::log(lmfbCoef[i]);
+}
+
+/* Log Mel filterbank on a block of frames
+ * The block version of applyLogMelFilterbank: the K x numFFTBins power spectra times the transposed banded filterbank.
+ * For every nonzero weight the whole row of K frames is updated, so the innermost loop is an axpy over contiguous memory.
+ * The axpy kernels are elementwise, the block results are therefore the same on every instruction set.
+ */
+template <typename T>
+void MfccExtractor<T>::applyLogMelFilterbankBlock(size_t K) {
+    const melFilterbank<T> &fbank = plan->fbank;
+    std::fill(blockLmfb.begin(), blockLmfb.begin() + numFilters*K, T(0));
+
+    for (size_t i=0; i<numFilters; i++) {
+        T* acc = &blockLmfb[i*K];
+        const T* w = &fbank.weights[fbank.offset[i]];
+        for (size_t bin=fbank.firstBin[i]; bin<=fbank.lastBin[i]; bin++, w++)
+            kernels->axpy(*w, &blockPower[bin*K], acc, K);
+        // Apply Mel-flooring and log
+        for (size_t k=0; k<K; k++)
+            acc[k] = std::log(acc[k] < 1 ? T(1) : acc[k]);
+    }
+}
+
+/* Computing discrete cosine transform
+ * It turns out that filter bank coefficients computed in the previous step are highly correlated, which could be
+ * problematic in some machine learning algorithms. Therefore, we can apply Discrete Cosine Transform (DCT)
+ * to decorrelate the filter bank coefficients and yield a compressed representation of the filter banks. Typically,
+ * for Automatic Speech Recognition (ASR), the resulting cepstral coefficients 2-13 are retained and the rest are discarded.
+ */
+template <typename T>
+void MfccExtractor<T>::applyDct(void) {
+    const std::vector<std::vector<T>> &dct = plan->dct;
+    for (size_t i=0; i<=numCepstral; i++)
+        mfcc[i] = kernels->dot(dct[i].data(), lmfbCoef.data(), numFilters);
+}
+
+// Discrete cosine transform on a block of frames, (numCepstral+1) x numFilters times numFilters x K
+template <typename T>
+void MfccExtractor<T>::applyDctBlock(size_t K) {
+    const std::vector<std::vector<T>> &dct = plan->dct;
+    std::fill(blockMfcc.begin(), blockMfcc.begin() + (numCepstral+1)*K, T(0));
+
+    for (size_t i=0; i<=numCepstral; i++) {
+        T* acc = &blockMfcc[i*K];
+        for (size_t j=0; j<numFilters; j++)
+            kernels->axpy(dct[i][j], &blockLmfb[j*K], acc, K);
+    }
+}
+
+// ***** Delta features *****
+
+template <typename T>
+DeltaFilter<T>::DeltaFilter(size_t dims, size_t order, size_t window, const mfccKernels<T> &kernels)
+    : dims(dims), deltaOrder(order), theta(std::max(window, (size_t) 1)), kernels(&kernels),
+      rows((order + 1) * theta + 1, std::vector<T>(dims * (order + 1), 0)), numFrames(0), numSteps(0), numOutput(0)
+{
+    double norm = 0;
+    for (size_t k=1; k<=theta; k++)
+        norm += 2.0 * k * k;
+    for (size_t k=1; k<=theta; k++)
+        weights.push_back(T(k / norm));
+}
+
+template <typename T>
+const std::vector<T>* DeltaFilter<T>::push(const T* features) {
+    std::copy(features, features + dims, row(numFrames).begin());
+    numFrames++;
+    return step(numFrames - 1);
+}
+
+template <typename T>
+const std::vector<T>* DeltaFilter<T>::flush() {
+    while (numOutput < numFrames) {
+        if (const std::vector<T>* frame = step(numFrames - 1))
+            return frame;
+    }
+    return 0;
+}
+
+/* Regressions
+ * Step k computes the regression of order s for frame k - s * window, whose inputs of order s-1 reach up to the
+ * frame computed by the previous order in the same step, and then completes frame k - latency(). Neighbours before
+ * frame 0 or after frame last are clamped to them. The ring covers frame k back to the oldest neighbour read.
+ */
+template <typename T>
+const std::vector<T>* DeltaFilter<T>::step(size_t last) {
+    size_t k = numSteps++;
+    for (size_t s=1; s<=deltaOrder && s*theta<=k; s++) {
+        size_t t = k - s*theta;
+        if (t > last)
+            continue;
+        T* out = &row(t)[s*dims];
+        std::fill(out, out + dims, T(0));
+        for (size_t d=1; d<=theta; d++) {
+            const T* next = &row(std::min(t + d, last))[(s-1)*dims];
+            const T* previous = &row(t >= d ? t - d : 0)[(s-1)*dims];
+            kernels->axpy(weights[d-1], next, out, dims);
+            kernels->axpy(-weights[d-1], previous, out, dims);
+        }
+    }
+
+    if (k < latency() || k - latency() > last)
+        return 0;
+    numOutput++;
+    return &row(k - latency());
+}
+
+// ***** Initialisation routines *****
+
+bool MfccConfig::operator<(const MfccConfig &other) const {
+    return std::tie(fs, numCepstral, numFilters, numFFT, winWidth, frameShift, lowFreq, highFreq)
+            < std::tie(other.fs, other.numCepstral, other.numFilters, other.numFFT, other.winWidth, other.frameShift,
+                       other.lowFreq, other.highFreq);
+}
+
+/* Plan cache
+ * Plans are never evicted, a process uses a handful of configurations. There is one cache per precision; the FFTW
+ * planner and the wisdom file, which are not thread-safe, are serialised across both by fftwPlannerMutex(), so
+ * extractors of either precision can be created on any thread.
+ */
+template <typename T>
+std::shared_ptr<const MfccPlan<T>> MfccPlan<T>::get(const MfccConfig &config) {
+    static QMutex mutex;
+    static std::map<MfccConfig, std::shared_ptr<const MfccPlan<T>>> plans;
+
+    QMutexLocker locker(&mutex);
+    std::shared_ptr<const MfccPlan<T>> &plan = plans[config];
+    if (!plan)
+        plan.reset(new MfccPlan<T>(config));
+    return plan;
+}
+
+template <typename T>
+MfccPlan<T>::MfccPlan(const MfccConfig &config)
+    : config(config), fftwPlan(0), fftwIn(0), fftwOut(0)
+{
+    winWidthSamples = config.winWidth * config.fs / 1000;
+    frameShiftSamples = config.frameShift * config.fs / 1000;
+    numWindowSamples = std::min(winWidthSamples, config.numFFT);
+    numFFTBins = config.numFFT / 2 + 1;
+
+    initFilterbank();
+    initHammingDct();
+    fftPlan.init(config.numFFT);
+    initFFTW();
+
+    // Bins above the last filter never reach the filterbank, the block only keeps the ones below
+    numBlockBins = fbank.lastBin.back() + 1;
+}
+
+template <typename T>
+MfccPlan<T>::~MfccPlan()
+{
+    if (fftwPlan) {
+        QMutexLocker locker(&fftwPlannerMutex());
+        fftw_destroy_plan(fftwPlan);
+    }
+    fftw_free(fftwIn);
+    fftw_free(fftwOut);
+}
+
+// Precompute filterbank, the filters end at the Nyquist frequency at most
+template <typename T>
+void MfccPlan<T>::initFilterbank(void) {
+    size_t fs = config.fs;
+    size_t numFilters = config.numFilters;
+
+    // Convert low and high frequencies to Mel scale
+    double lowFreqMel = Hz2Mel(config.lowFreq);
+    double highFreqMel = Hz2Mel(std::min(config.highFreq, fs / 2.0));
+
+    // Calculate filter centre-frequencies
+    std::vector<double> filterCentreFreq;
+    filterCentreFreq.reserve(numFilters+2);
+    for (size_t i=0; i<numFilters+2; i++)
+        filterCentreFreq.push_back(Mel2Hz(lowFreqMel + (highFreqMel-lowFreqMel)/(numFilters+1)*i));
+
+    // Calculate FFT bin frequencies
+    std::vector<double> fftBinFreq;
+    fftBinFreq.reserve(numFFTBins);
+    for (size_t i=0; i<numFFTBins; i++)
+        fftBinFreq.push_back(fs/2.0/(numFFTBins-1)*i);
+
+    // Allocate memory for the filterbank
+    fbank.firstBin.assign(numFilters, 0);
+    fbank.lastBin.assign(numFilters, 0);
+    fbank.offset.assign(numFilters, 0);
+    fbank.weights.clear();
+
+    // Populate the banded filterbank, keeping only the nonzero run of weights of each filter
+    for (size_t filt=1; filt<=numFilters; filt++) {
+        std::vector<double> ftemp;
+        for (size_t bin=0; bin<numFFTBins; bin++) {
+            double weight;
+            if (fftBinFreq[bin] < filterCentreFreq[filt-1])
+                weight = 0;
+            else if (fftBinFreq[bin] <= filterCentreFreq[filt])
+                weight = (fftBinFreq[bin] - filterCentreFreq[filt-1]) / (filterCentreFreq[filt] - filterCentreFreq[filt-1]);
+            else if (fftBinFreq[bin] <= filterCentreFreq[filt+1])
+                weight = (filterCentreFreq[filt+1] - fftBinFreq[bin]) / (filterCentreFreq[filt+1] - filterCentreFreq[filt]);
+            else
+                weight = 0;
+            ftemp.push_back(weight);
+        }
+
+        size_t first = 0, last = 0;
+        while (first < numFFTBins && ftemp[first] == 0)
+            first++;
+        if (first == numFFTBins)
+            first = 0;      // Filter narrower than one bin, keep a single zero weight
+        for (size_t bin=first; bin<numFFTBins; bin++)
+            if (ftemp[bin] != 0)
+                last = bin;
+        if (last < first)
+            last = first;
+
+        fbank.firstBin[filt-1] = first;
+        fbank.lastBin[filt-1] = last;
+        fbank.offset[filt-1] = fbank.weights.size();
+        fbank.weights.insert(fbank.weights.end(), ftemp.begin()+first, ftemp.begin()+last+1);
+    }
+}
+
+// Precompute Hamming window and dct matrix
+template <typename T>
+void MfccPlan<T>::initHammingDct(void) {
+    size_t numCepstral = config.numCepstral;
+    size_t numFilters = config.numFilters;
+    size_t i, j;
+
+    // After slicing the signal into frames, we apply a window function such as the Hamming window to each frame.
+    // Only the samples that reach the FFT need it.
+    hamming.assign(numWindowSamples, 0);
+    for (i=0; i<numWindowSamples; i++)
+        hamming[i] = 0.54 - 0.46 * cos(2 * PI_MFCC * i / (winWidthSamples-1));
+
+    std::vector<double> v1(numCepstral+1,0), v2(numFilters,0);
+    for (i=0; i <= numCepstral; i++)
+        v1[i] = i;
+    for (i=0; i < numFilters; i++)
+        v2[i] = i + 0.5;
+
+    dct.reserve(numFilters*(numCepstral+1));
+    double c = sqrt(2.0/numFilters);
+    for (i=0; i<=numCepstral; i++) {
+        std::vector<T> dtemp;
+        for (j=0; j<numFilters; j++)
+            dtemp.push_back(c * cos(PI_MFCC / numFilters * v1[i] * v2[j]));
+        dct.push_back(dtemp);
+    }
+}
+
+/* FFTW plan
+ * Every MfccPlan keeps one real-to-complex plan, the extractors execute it on their own buffers from fftw_malloc,
+ * which have the alignment it was measured with. Plans are measured (FFTW_MEASURE) rather than estimated, which is
+ * slow the first time, so the accumulated wisdom is imported from and exported to fftwWisdomPath() and later runs get
+ * the measured plan without the planning cost. The planner and the wisdom only run under fftwPlannerMutex().
+ */
+template <typename T>
+void MfccPlan<T>::initFFTW(void) {
+    size_t numFFT = config.numFFT;
+    QMutexLocker locker(&fftwPlannerMutex());
+    QString path = currentWisdomPath();
+
+    if (!fftwWisdomImported && !path.isEmpty()) {
+        if (!fftw_import_wisdom_from_filename(QFile::encodeName(path).constData()))
+            qDebug() << "No FFTW wisdom found in" << path << "- measuring new plans";
+        fftwWisdomImported = true;
+    }
+
+    fftwIn = (double*)fftw_malloc(sizeof(double) * numFFT);
+    fftwOut = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * numFFTBins);
+
+    // Reuse the wisdom if it already covers this size, otherwise measure and save the new plan
+    fftwPlan = fftw_plan_dft_r2c_1d(numFFT, fftwIn, fftwOut, FFTW_MEASURE | FFTW_WISDOM_ONLY);
+    if (!fftwPlan) {
+        fftwPlan = fftw_plan_dft_r2c_1d(numFFT, fftwIn, fftwOut, FFTW_MEASURE);
+        if (!path.isEmpty() && (!QDir().mkpath(QFileInfo(path).absolutePath())
+                                || !fftw_export_wisdom_to_filename(QFile::encodeName(path).constData())))
+            qDebug() << "Unable to write FFTW wisdom to" << path;
+    }
+}
+
+template class MfccPlan<float>;
+template class MfccPlan<double>;
+template class DeltaFilter<float>;
+template class DeltaFilter<double>;
+template class MfccExtractor<float>;
+template class MfccExtractor<double>;
@@ -0,0 +1,266 @@
+#ifndef MFCCEXTRACTOR
+#define MFCCEXTRACTOR
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QString>
+
+#include "fftplan.h"
+#include "fftw3.h"
+#include "simdkernels.h"
+#include "spectralfeatures.h"
+
+class QMutex;
+
+// Spectral backend used by the power spectrum computation
+enum SpectrumBackend { BuiltinFFT, FFTW };
+
+// Lock around every FFTW planner call, wisdom access and fftw_destroy_plan, which are not thread-safe.
+// fftw_execute on an existing plan needs no lock.
+QMutex &fftwPlannerMutex();
+
+// File the measured FFTW plans are kept in across runs, by default fftw.wisdom in the writable
+// QStandardPaths::AppDataLocation. A new path is read before the next plan is built, an empty one disables the file.
+void setFftwWisdomPath(const QString &path);
+QString fftwWisdomPath();
+
+/* Banded Mel filterbank
+ * Each triangular filter is only nonzero between its left and right neighbour centre frequencies, so instead of
+ * a dense numFilters x numFFTBins matrix only the band [firstBin, lastBin] of every filter is kept. The weights of
+ * all filters are stored back to back in weights, filter i starting at offset[i].
+ */
+template <typename T>
+struct melFilterbank {
+    std::vector<size_t>     firstBin;           // First nonzero FFT bin of each filter
+    std::vector<size_t>     lastBin;            // Last nonzero FFT bin of each filter
+    std::vector<size_t>     offset;             // Start of each filter's weights in weights
+    std::vector<T>          weights;            // Nonzero weights of all filters, contiguous
+};
+
+/**
+ * Streaming delta and delta-delta features, appended to the dims static features of every frame. The deltas are the
+ * regression over window frames on either side, d(t) = sum_k k * (c(t+k) - c(t-k)) / (2 * sum_k k^2), and the
+ * delta-deltas the same regression over the deltas. Frames beyond either end of the stream repeat the first or the
+ * last one, as in HTK. A frame is complete once the frame latency() frames after it has arrived, so the output runs
+ * latency() frames behind the input. Only a ring of the last (order + 1) * window + 1 frames is kept and nothing is
+ * allocated per frame; order 0 passes the static features through without delay.
+ */
+template <typename T>
+class DeltaFilter
+{
+public:
+    DeltaFilter(size_t dims = 0, size_t order = 0, size_t window = 2,
+                const mfccKernels<T> &kernels = mfccKernelsDetected<T>());
+
+    void setKernels(const mfccKernels<T> &kernels) { this->kernels = &kernels; }
+
+    size_t order() const { return deltaOrder; }
+    size_t window() const { return theta; }
+    size_t latency() const { return deltaOrder * theta; }
+    size_t outputSize() const { return dims * (deltaOrder + 1); }
+
+    // Start a new stream
+    void reset() { numFrames = numSteps = numOutput = 0; }
+    // Add the static features of the next frame and return the frame completed by them, 0 while there is none.
+    // The vector belongs to the filter and stays valid until the next call.
+    const std::vector<T>* push(const T* features);
+    // At the end of the stream, return the frames still held back one by one and 0 when all are out
+    const std::vector<T>* flush();
+
+private:
+    const std::vector<T>* step(size_t last);
+    std::vector<T>& row(size_t frame) { return rows[frame % rows.size()]; }
+
+    size_t                          dims;
+    size_t                          deltaOrder;
+    size_t                          theta;
+    const mfccKernels<T>*           kernels;
+    std::vector<T>                  weights;        // k / (2 * sum_k k^2) for k = 1 .. window
+    std::vector<std::vector<T>>     rows;           // Output frames by frame index, static features first
+    size_t                          numFrames;      // Frames pushed
+    size_t                          numSteps;       // Frames whose regressions are done
+    size_t                          numOutput;      // Frames returned
+};
+
+// Configuration of an MFCC analysis, the key of its plan
+struct MfccConfig {
+    size_t      fs;                 // Sampling rate in Hertz
+    size_t      numCepstral;        // Number of output cepstra, excluding log-energy
+    size_t      numFilters;         // Number of Mel warped filters in filterbank
+    size_t      numFFT;             // N-point FFT on each frame
+    size_t      winWidth;           // Width of analysis window in milliseconds
+    size_t      frameShift;         // Frame shift in milliseconds
+    double      lowFreq;            // Filterbank low frequency cutoff in Hertz
+    double      highFreq;           // Filterbank high freqency cutoff in Hertz, fs/2 at most is used
+
+    bool operator<(const MfccConfig &other) const;
+    bool operator==(const MfccConfig &other) const { return !(*this < other) && !(other < *this); }
+    bool operator!=(const MfccConfig &other) const { return !(*this == other); }
+};
+
+/**
+ * Immutable tables of one MfccConfig: Hamming window, banded Mel filterbank, DCT matrix and the FFT plans.
+ * A plan is built once per configuration and process. get() is thread-safe and returns the shared plan, so further
+ * extractors of a configuration start without computing a single table and all of them read it concurrently.
+ * The FFTW plan is executed on the buffers of each extractor through fftw_execute_dft_r2c, which is safe on several
+ * threads at once; creating and destroying the plan only happens under fftwPlannerMutex().
+ */
+template <typename T>
+class MfccPlan
+{
+public:
+    static std::shared_ptr<const MfccPlan> get(const MfccConfig &config);
+    ~MfccPlan();
+
+    MfccPlan(const MfccPlan &) = delete;
+    MfccPlan &operator=(const MfccPlan &) = delete;
+
+    MfccConfig                      config;
+    size_t                          winWidthSamples;
+    size_t                          frameShiftSamples;
+    size_t                          numWindowSamples;       // Samples of the window that reach the FFT
+    size_t                          numFFTBins;
+    size_t                          numBlockBins;           // Bins up to the last one of the last filter
+
+    std::vector<T>                  hamming;
+    std::vector<std::vector<T>>     dct;
+    melFilterbank<T>                fbank;
+    FFTPlan<T>                      fftPlan;
+    fftw_plan                       fftwPlan;
+
+private:
+    explicit MfccPlan(const MfccConfig &config);
+    void initFilterbank(void);
+    void initHammingDct(void);
+    void initFFTW(void);
+
+    // Buffers the FFTW plan is measured on
+    double*                         fftwIn;
+    fftw_complex*                   fftwOut;
+};
+
+/**
+ * MFCC feature extractor: pre-emphasis and Hamming window, power spectrum, log Mel filterbank and DCT.
+ * The sample precision is a template parameter, float and double are instantiated. Tables are computed in double
+ * and rounded once, everything per frame runs in T. The tables come from the shared MfccPlan of the configuration,
+ * an extractor only owns its frame buffers.
+ */
+template <typename T>
+class MfccExtractor
+{
+public:
+    MfccExtractor(size_t fs = 44100, size_t numCepstral = 12, size_t numFilters = 40, size_t numFFT = 512,
+                  size_t winWidth = 25, size_t frameShift = 10, double lowFreq = 50, double highFreq = 4000);
+    ~MfccExtractor();
+
+    MfccExtractor(const MfccExtractor &) = delete;
+    MfccExtractor &operator=(const MfccExtractor &) = delete;
+
+    // Maximum number of frames the block kernels process at once
+    static const size_t blockFrames = 64;
+
+    void setSpectrumBackend(SpectrumBackend backend);
+    SpectrumBackend spectrumBackend() const { return backend; }
+    void setKernels(const mfccKernels<T> &kernels);
+    const mfccKernels<T>& activeKernels() const { return *kernels; }
+
+    // Switch to another configuration, the stream starts over
+    void configure(const MfccConfig &config);
+    void setSampleRate(size_t fs);
+    const MfccConfig& config() const { return plan->config; }
+
+    size_t sampleRate() const { return fs; }
+    size_t numCoefficients() const { return numCepstral + 1; }
+    // MFCCs followed by the spectral features, the size of the vectors of processFrame and processBlock
+    size_t numStaticFeatures() const { return numCepstral + 1 + spectral.size(); }
+    size_t overlapSamples() const { return winWidthSamples - frameShiftSamples; }
+    size_t shiftSamples() const { return frameShiftSamples; }
+
+    // Append the SpectralFeature flags features to the MFCCs of every frame, computed from the same power spectrum
+    void setSpectralFeatures(unsigned features);
+    unsigned spectralFeatures() const { return spectral.features(); }
+    // The spectral flux needs the previous frame, a block starting in the middle of a recording has to repeat it
+    bool needsPreviousFrame() const { return spectral.needsPreviousFrame(); }
+
+    // Append deltas (order 1) or deltas and delta-deltas (order 2) over window frames to the MFCCs of a stream
+    void setDeltaOrder(size_t order, size_t window = 2);
+    size_t deltaOrder() const { return deltas.order(); }
+    // Size of the feature vectors of a stream, and the number of frames they trail the samples by
+    size_t numFeatures() const { return deltas.outputSize(); }
+    size_t latencyFrames() const { return deltas.latency(); }
+
+    // Set the overlapSamples() samples that precede the first frame
+    void setOverlap(const int16_t* samples);
+    // Add shiftSamples() new samples and return the MFCCs and spectral features of the completed frame, valid until
+    // the next call
+    const std::vector<T>& processFrame(const int16_t* samples);
+    // Add numFrames * shiftSamples() new samples and append the MFCCs and spectral features of every completed frame
+    void processBlock(const int16_t* samples, size_t numFrames, std::vector<std::vector<T>> &mfccs);
+
+    // Called with the features of every frame completed by pushSamples, its MFCCs followed by the deltas of
+    // setDeltaOrder. The vector is only valid during the call.
+    typedef std::function<void(const std::vector<T>&)> FrameCallback;
+    // Start a new stream, the first overlapSamples() pushed samples become the overlap
+    void resetStream();
+    // Add n samples of a stream, any chunk size, and report each completed frame to callback
+    void pushSamples(const int16_t* samples, size_t n, const FrameCallback &callback);
+    // End the stream and report the latencyFrames() frames still waiting for their deltas
+    void finishStream(const FrameCallback &callback);
+
+private:
+    void pushFrameSamples(const int16_t* samples);
+    void emitFrame(const std::vector<T> &mfcc, const FrameCallback &callback);
+    void preEmphHamming(void);
+    void compPowerSpec(void);
+    void powerSpectrumFFTW(void);
+    void applyLogMelFilterbank(void);
+    void applyDct(void);
+    void applyLogMelFilterbankBlock(size_t K);
+    void applyDctBlock(size_t K);
+
+    std::shared_ptr<const MfccPlan<T>>  plan;
+
+    size_t      fs;
+    size_t      numCepstral;
+    size_t      numFilters;
+    size_t      numFFT;
+    T           preEmphCoef;
+
+    size_t      winWidthSamples;
+    size_t      frameShiftSamples;
+    size_t      numWindowSamples;       // Samples of the window that reach the FFT, min(winWidthSamples, numFFT)
+    size_t      numFFTBins;
+    size_t      numBlockBins;
+
+    // Circular buffer of the last winWidthSamples samples, ringHead is the oldest once a frame is complete
+    std::vector<int16_t>            ring;
+    size_t                          ringHead;
+
+    // Samples of a stream that do not complete the overlap or a frame yet
+    std::vector<int16_t>            streamPending;
+    size_t                          streamFill;
+    bool                            streamStarted;
+    DeltaFilter<T>                  deltas;
+
+    // frame holds the first numWindowSamples samples of the current frame, procFrame the windowed frame
+    // zero-padded to numFFT. All buffers are sized by configure, processing a frame allocates nothing.
+    std::vector<T>                  frame, procFrame, powerSpectralCoef, lmfbCoef, mfcc;
+    std::vector<std::complex<T>>    spectrum;
+
+    // Power spectra, log Mel energies and MFCCs of up to blockFrames frames, stored with the frame index
+    // running fastest (bin-major, filter-major and cepstrum-major) so the block kernels stream over contiguous frames
+    std::vector<T>                  blockPower, blockLmfb, blockMfcc;
+    // Spectral features of the frames of a block, frame-major
+    std::vector<T>                  blockSpectral;
+    SpectralFeatures<T>             spectral;
+
+    const mfccKernels<T>*   kernels;
+    SpectrumBackend         backend;
+    double*                 fftwIn;
+    fftw_complex*           fftwOut;
+};
+
+#endif // MFCCEXTRACTOR
@@ -0,0 +1,71 @@
+#include "noveltycurve.h"
+
+#include <algorithm>
+#include <math.h>
+
+/* Checkerboard kernel in lag coordinates
+ * The kernel weighs the measure of frames i and j in the window [t-W, t+W) by +g if both are on the same side of the
+ * boundary t and by -g otherwise, g being a Gaussian of their distance from the centre with a standard deviation of
+ * taper * W. The measures are distances 1 - cos, so the correlation is negated to turn high similarity within the
+ * halves into high novelty. The kernel is symmetric, the pairs i > j are counted twice and the diagonal, whose
+ * distances are 0, is left out.
+ *
+ * Along lag l = i - j the pairs of the window are i = t-W+l .. t+W-1. Their weights do not depend on t, so the
+ * correlation is one dot product per lag between fixed weights and a contiguous run of the lag-major band.
+ * The weights are normalised to a sum of absolute values of 1.
+ */
+NoveltyCurve::NoveltyCurve(size_t halfWidth, double taper, const mfccKernels<float> &kernels)
+    : W(halfWidth), kernels(&kernels), lagWeights(2*halfWidth)
+{
+    double sigma = taper * W;
+    double total = 0;
+    std::vector<std::vector<double>> weights(2*W);
+    for (size_t l=1; l<2*W; l++) {
+        for (size_t k=0; k<2*W-l; k++) {
+            double a = k + l + 0.5 - W;     // i - t + 1/2
+            double b = k + 0.5 - W;         // j - t + 1/2
+            double g = exp(-(a*a + b*b) / (2*sigma*sigma));
+            double sign = (a > 0) == (b > 0) ? 1 : -1;
+            weights[l].push_back(-2 * sign * g);
+            total += 2 * g;
+        }
+    }
+    for (size_t l=1; l<2*W; l++)
+        for (size_t k=0; k<weights[l].size(); k++)
+            lagWeights[l].push_back(float(weights[l][k] / total));
+}
+
+bool NoveltyCurve::update(const BandedSimilarityMatrix<float> &band) {
+    if (band.maxLag() < requiredLag())
+        return false;
+
+    // Frame t needs the frames up to t+W-1
+    size_t n = band.size() >= W ? band.size() - W + 1 : 0;
+    for (size_t t=novelty.size(); t<n; t++) {
+        if (t < W) {
+            novelty.push_back(0);
+            continue;
+        }
+        float sum = 0;
+        for (size_t l=1; l<2*W; l++)
+            sum += kernels->dot(lagWeights[l].data(), band.lag(l) + t - W + l, 2*W - l);
+        novelty.push_back(sum);
+    }
+    return true;
+}
+
+std::vector<size_t> NoveltyCurve::boundaries(float threshold) const {
+    std::vector<size_t> peaks;
+    for (size_t t=0; t<novelty.size(); t++) {
+        if (!(novelty[t] >= threshold))
+            continue;
+        bool isPeak = true;
+        size_t first = t >= W ? t - W : 0;
+        size_t last = std::min(t + W + 1, novelty.size());
+        for (size_t u=first; u<last && isPeak; u++)
+            isPeak = novelty[u] < novelty[t] || (novelty[u] == novelty[t] && u >= t);
+        if (isPeak)
+            peaks.push_back(t);
+    }
+    return peaks;
+}
@@ -0,0 +1,49 @@
+#ifndef NOVELTYCURVE
+#define NOVELTYCURVE
+
+#include <cstddef>
+#include <vector>
+
+#include "similaritymatrix.h"
+#include "simdkernels.h"
+
+/**
+ * Novelty curve of Foote (2000): a Gaussian-tapered checkerboard kernel of 2W x 2W frames is correlated along the
+ * main diagonal of the self-similarity matrix. values()[t] is large where the frames [t-W, t) are similar among
+ * themselves and to [t, t+W) dissimilar, i.e. at a segment boundary in front of frame t.
+ *
+ * Only measures less than 2W frames apart are used, so the curve is computed from a banded matrix with
+ * maxLag() >= requiredLag() and never needs the full one. update() follows a growing band at O(W^2) per frame,
+ * the value of frame t is final W frames after it.
+ */
+class NoveltyCurve
+{
+public:
+    NoveltyCurve(size_t halfWidth = 32, double taper = 0.5,
+                 const mfccKernels<float> &kernels = mfccKernelsDetected<float>());
+
+    void setKernels(const mfccKernels<float> &kernels) { this->kernels = &kernels; }
+    const mfccKernels<float>& activeKernels() const { return *kernels; }
+
+    size_t halfWidth() const { return W; }
+    size_t requiredLag() const { return 2*W - 1; }
+
+    // Append the values of the frames whose window is complete in band, false if the band is too narrow
+    bool update(const BandedSimilarityMatrix<float> &band);
+    void reset() { novelty.clear(); }
+
+    // Novelty of frames 0 .. size()-1, frames closer than W to the start are 0
+    const std::vector<float>& values() const { return novelty; }
+    size_t size() const { return novelty.size(); }
+
+    // Frames whose novelty is at least threshold and the largest within W frames on either side
+    std::vector<size_t> boundaries(float threshold) const;
+
+private:
+    size_t                              W;
+    const mfccKernels<float>*           kernels;
+    std::vector<std::vector<float>>     lagWeights;     // Kernel along lag l = 1 .. 2W-1, 2W - l weights each
+    std::vector<float>                  novelty;
+};
+
+#endif // NOVELTYCURVE
@@ -5,9 +5,12 @@
 #include "self-similarity.h"
 #include "restful.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
+#include <QMutex>
+
 const int NullIndex = -1;
 int m_selection;
 int m_positionSelected = 0;
@@ -21,7 +24,10 @@ extern QVector<qreal> levelsAll;
 extern QVector<qreal> levelsSpectrum;
 extern QVector<qreal> frequenciesSpectrum;
 
-extern std::vector<double> vecdsimilarity;
+extern PackedSimilarityMatrix<float> similarityMatrix;
+extern BandedSimilarityMatrix<float> bandedSimilarity;
+extern SimilarityFile similarityFile;
+extern SimilarityPyramid similarityPyramid;
 
 QString bufferCodec;
 QString bufferSampleRate;
@@ -82,9 +88,44 @@ PaintedLevels::PaintedLevels(QQuickItem *parent) : QQuickPaintedItem(parent)
     paint_face = false;
     paint_similarity = false;
     status_calculateLevels = false;
+    m_similarityZoom = 0;
     status_blank = false;
 }
 
+// Draw one self-similarity measure as a square cell, blending from white for identical frames to black
+static void paintSimilarityCell(QPainter *painter, qreal x, qreal y, qreal size, float measure)
+{
+    QColor stwhite = QColor(255, 255, 255, 255);
+    QColor stblack = QColor(0, 0, 0, 255);
+
+    float scale = measure / 0.015;    // scale self-similarity measures to the range
+    if (scale < 0.0) scale = 0.0;
+    if (scale > 1.0) scale = 1.0;
+
+    float red = 0.0;
+    float green = 0.0;
+    float blue = 0.0;
+    float alpha = 0.0;
+
+    red += (1 - scale) * stwhite.redF();
+    green += (1 - scale) * stwhite.greenF();
+    blue += (1 - scale) * stwhite.blueF();
+    alpha += (1 - scale) * stwhite.alphaF();
+
+    red += scale * stblack.redF();
+    green += scale * stblack.greenF();
+    blue += scale * stblack.blueF();
+    alpha += scale * stblack.alphaF();
+
+    QColor color = QColor::fromRgbF(red, green, blue, alpha);
+
+    QPen pen(color, 1);
+    painter->setPen(pen);
+    QBrush brush = QBrush(color);
+    painter->setBrush(brush);
+    painter->drawRect(QRectF(x, y, size, size));
+}
+
 void PaintedLevels::paint(QPainter *painter)
 {
     painter->setRenderHints(QPainter::Antialiasing, true);
@@ -235,41 +276,59 @@ void PaintedLevels::paint(QPainter *painter)
     }
 
     if (paint_similarity == true) {
-        QColor stwhite = QColor(255, 255, 255, 255);
-        QColor stblack = QColor(0, 0, 0, 255);
-
-        float d = 0;
-        for (size_t j=0; j<365; j++) {
-            if (j > 0) d += j-1;
-            for (size_t i=0; i<790-j; i++) {
-                float scale = vecdsimilarity[j*790 - d + i] / 0.015;    // scale self-similarity measures to the range
-                if (scale < 0.0) scale = 0.0;
-                if (scale > 1.0) scale = 1.0;
-
-                float red = 0.0;
-                float green = 0.0;
-                float blue = 0.0;
-                float alpha = 0.0;
-
-                red += (1 - scale) * stwhite.redF();
-                green += (1 - scale) * stwhite.greenF();
-                blue += (1 - scale) * stwhite.blueF();
-                alpha += (1 - scale) * stwhite.alphaF();
-
-                red += scale * stblack.redF();
-                green += scale * stblack.greenF();
-                blue += scale * stblack.blueF();
-                alpha += scale * stblack.alphaF();
-
-                QColor color = QColor::fromRgbF(red, green, blue, alpha);
-
-                QPen pen(color, 1);
-                painter->setPen(pen);
-                QBrush brush = QBrush(color);
-                painter->setBrush(brush);
-                float x = j * 1.0 + i * 1.0;
-                float y = j * 1.0;
-                painter->drawRect(x, y, 1.0, 1.0);
+        if (bandedSimilarity.size() > 0) {
+            // Banded mode draws the time-lag image, frame i against frame i - l at x = i, y = l. Every line is one
+            // contiguous lag of the matrix, clipped to the item.
+            size_t numLags = std::min(bandedSimilarity.maxLag() + 1, (size_t) height());
+            size_t numFrames = std::min(bandedSimilarity.size(), (size_t) width());
+            for (size_t l=0; l<numLags; l++) {
+                const float* lag = bandedSimilarity.lag(l);
+                for (size_t i=l; i<numFrames; i++)
+                    paintSimilarityCell(painter, i, l, 1.0, lag[i]);
+            }
+        } else {
+            // Frames per pixel of the view, by default the whole recording fits into the width of the item. Zoomed out
+            // by 2 or more, a level of similarityPyramid with one to two measures per pixel is drawn instead of the
+            // matrix, so the time to draw does not grow with the length of the recording.
+            size_t n = similarityFile.numFrames() > 0 ? similarityFile.numFrames() : similarityMatrix.size();
+            qreal framesPerPixel = m_similarityZoom > 0 ? m_similarityZoom : std::max(1.0, n / width());
+            size_t k = similarityPyramid.size() == n ? similarityPyramid.levelFor(framesPerPixel) : 0;
+            qreal cell = (1 << k) / framesPerPixel;
+
+            if (k > 0) {
+                const PackedSimilarityMatrix<float> &level = similarityPyramid.level(k);
+                size_t numCols = std::min(level.size(), (size_t) ceil(width() / cell));
+                size_t numRows = std::min(numCols, (size_t) ceil(height() / cell));
+                for (size_t j=0; j<numCols; j++) {
+                    const float* stored = level.row(j);
+                    for (size_t i=0; i<=j && i<numRows; i++)
+                        paintSimilarityCell(painter, j * cell, i * cell, cell, stored[i]);
+                }
+            } else if (similarityFile.numFrames() > 0) {
+                // Out-of-core matrix, drawn like the one in memory tile by tile. Only the tiles inside the item are
+                // touched, so only their pages of the mapped file are read.
+                size_t T = similarityFile.tileSize();
+                size_t numCols = std::min(n, (size_t) ceil(width() / cell));
+                size_t numRows = std::min(numCols, (size_t) ceil(height() / cell));
+                for (size_t tr=0; tr*T<numCols; tr++) {
+                    for (size_t tc=0; tc<=tr && tc*T<numRows; tc++) {
+                        const float* tile = similarityFile.tile(tr, tc);
+                        for (size_t j=tr*T; j<std::min(tr*T + T, numCols); j++)
+                            for (size_t i=tc*T; i<=j && i<std::min(tc*T + T, numRows); i++)
+                                paintSimilarityCell(painter, j * cell, i * cell, cell, tile[(j - tr*T)*T + i - tc*T]);
+                    }
+                }
+            } else {
+                // The matrix is symmetric, frame i against frame j >= i is drawn at x = j, y = i. Stored row j holds
+                // these measures for all i <= j contiguously, so the upper triangle is walked as the stored rows,
+                // clipped to the item.
+                size_t numCols = std::min(n, (size_t) ceil(width() / cell));
+                size_t numRows = std::min(numCols, (size_t) ceil(height() / cell));
+                for (size_t j=0; j<numCols; j++) {
+                    const float* stored = similarityMatrix.row(j);
+                    for (size_t i=0; i<=j && i<numRows; i++)
+                        paintSimilarityCell(painter, j * cell, i * cell, cell, stored[i]);
+                }
             }
         }
         paint_similarity = false;
@@ -438,13 +497,20 @@ void PaintedLevels::levelsFingerprint()                     // ok
         out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * n_out);
 
         // plan, real to complex, one dimension, speed of the computation, FFTW_ESTIMATE means as fast as possible
-        plan_forward = fftw_plan_dft_r2c_1d(bufferSize, in, out, FFTW_ESTIMATE);
+        // the planner is shared with the MFCC plans of other threads
+        {
+            QMutexLocker locker(&fftwPlannerMutex());
+            plan_forward = fftw_plan_dft_r2c_1d(bufferSize, in, out, FFTW_ESTIMATE);
+        }
 
         // fft is computed here
         fftw_execute(plan_forward);
 
         // release memory associated with the plan
-        fftw_destroy_plan(plan_forward);
+        {
+            QMutexLocker locker(&fftwPlannerMutex());
+            fftw_destroy_plan(plan_forward);
+        }
 
         int nFreqSamples = bufferSize / 2;
         int samplingRate = 44100;
@@ -780,6 +846,13 @@ void PaintedLevels::paintClicked(const QString &msg)
     }
 }
 
+void PaintedLevels::levelsSimilarityZoom(qreal framesPerPixel)
+{
+    m_similarityZoom = framesPerPixel;
+    paint_similarity = true;
+    update();
+}
+
 void PaintedLevels::getLocalFile(const QString &msg)
 {
     localFile = msg;
@@ -44,6 +44,9 @@ public slots:
 
     void getLocalFile(const QString &msg);
 
+    // Zoom of the self-similarity view in frames per pixel, 0 fits the whole recording into the width
+    void levelsSimilarityZoom(qreal framesPerPixel);
+
 private:
     qint64 audioLength(const QAudioFormat &format, qint64 microSeconds);
     QString formatToString(const QAudioFormat &format);
@@ -70,6 +73,8 @@ private:
     bool paint_similarity;
     bool status_blank;
     bool status_calculateLevels;
+
+    qreal m_similarityZoom;
 };
 
 #endif // PAINTEDLEVELS
@@ -0,0 +1,129 @@
+#include "repetitionindex.h"
+
+#include <algorithm>
+#include <random>
+
+RepetitionIndex::RepetitionIndex(size_t numTables, size_t bitsPerTable, uint32_t seed)
+    : tables(numTables), bits(std::min(bitsPerTable, (size_t) 64)), stride(0), seed(seed)
+{
+}
+
+/* Signatures
+ * The hyperplanes are drawn from a normal distribution, which makes their directions uniform. Centring a frame x on
+ * the mean m only moves the threshold of every sign, dot(h, x - m) > 0 is dot(h, x) > dot(h, m), so all signatures of
+ * a frame are one dotRows call against the hyperplanes. An all-zero frame has NaN measures and never matches, its
+ * NaN dot products give it the bucket of zeros.
+ */
+void RepetitionIndex::build(const FeatureMatrix &features, const mfccKernels<double> &kernels) {
+    size_t n = features.rows();
+    size_t numPlanes = tables * bits;
+    stride = features.stride();
+
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> normal;
+    planes.assign(numPlanes * stride, 0);
+    for (size_t p=0; p<numPlanes; p++)
+        for (size_t k=0; k<features.dims(); k++)
+            planes[p*stride + k] = normal(generator);
+
+    // Mean of the frames, all-zero frames left out
+    std::vector<double> mean(stride, 0);
+    size_t numValid = 0;
+    for (size_t i=0; i<n; i++)
+        numValid += features.row(i)[0] == features.row(i)[0];
+    for (size_t i=0; i<n; i++)
+        if (features.row(i)[0] == features.row(i)[0])
+            kernels.axpy(1.0 / numValid, features.row(i), mean.data(), stride);
+    std::vector<double> thresholds(numPlanes);
+    kernels.dotRows(mean.data(), planes.data(), stride, stride, numPlanes, thresholds.data());
+
+    entries.assign(tables, std::vector<Entry>(n));
+    std::vector<double> dots(numPlanes);
+    for (size_t i=0; i<n; i++) {
+        kernels.dotRows(features.row(i), planes.data(), stride, stride, numPlanes, dots.data());
+        for (size_t t=0; t<tables; t++) {
+            uint64_t key = 0;
+            for (size_t b=0; b<bits; b++)
+                key = key << 1 | (dots[t*bits + b] > thresholds[t*bits + b]);
+            entries[t][i].key = key;
+            entries[t][i].frame = i;
+        }
+    }
+
+    for (size_t t=0; t<tables; t++)
+        std::sort(entries[t].begin(), entries[t].end());
+}
+
+std::vector<SimilarPair> RepetitionIndex::similarPairs(const FeatureMatrix &features, float maxDistance, size_t minLag,
+                                                       size_t maxBucket, const mfccKernels<double> &kernels) const {
+    // Candidates are verified as they come up, only the pairs found similar are kept and merged across the tables
+    std::vector<SimilarPair> pairs;
+    for (size_t t=0; t<entries.size(); t++) {
+        const std::vector<Entry> &table = entries[t];
+        for (size_t p=0; p<table.size(); p++) {
+            for (size_t q=p+1; q<table.size() && q<=p+maxBucket && table[q].key == table[p].key; q++) {
+                size_t i = std::max(table[p].frame, table[q].frame);
+                size_t j = std::min(table[p].frame, table[q].frame);
+                if (i - j < minLag)
+                    continue;
+                float distance = float(1 - kernels.dot(features.row(i), features.row(j), features.stride()));
+                if (distance <= maxDistance) {
+                    SimilarPair pair = { i, j, distance };
+                    pairs.push_back(pair);
+                }
+            }
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end(), [](const SimilarPair &a, const SimilarPair &b) {
+        return a.i < b.i || (a.i == b.i && a.j < b.j);
+    });
+    pairs.erase(std::unique(pairs.begin(), pairs.end(), [](const SimilarPair &a, const SimilarPair &b) {
+        return a.i == b.i && a.j == b.j;
+    }), pairs.end());
+    return pairs;
+}
+
+std::vector<RepeatedSegment> RepetitionIndex::repeatedSegments(const std::vector<SimilarPair> &pairs, size_t minLength,
+                                                               size_t maxGap) {
+    std::vector<SimilarPair> diagonal(pairs);
+    std::sort(diagonal.begin(), diagonal.end(), [](const SimilarPair &a, const SimilarPair &b) {
+        return a.i - a.j < b.i - b.j || (a.i - a.j == b.i - b.j && a.j < b.j);
+    });
+
+    std::vector<RepeatedSegment> segments;
+    for (size_t start=0; start<diagonal.size(); ) {
+        size_t lag = diagonal[start].i - diagonal[start].j;
+        size_t end = start + 1;
+        while (end < diagonal.size() && diagonal[end].i - diagonal[end].j == lag
+               && diagonal[end].j - diagonal[end - 1].j <= maxGap + 1)
+            end++;
+
+        size_t length = diagonal[end - 1].j - diagonal[start].j + 1;
+        if (length >= minLength) {
+            RepeatedSegment segment = { diagonal[start].j, diagonal[start].j + lag, length };
+            segments.push_back(segment);
+        }
+        start = end;
+    }
+    return segments;
+}
+
+std::vector<SimilarPair> exactSimilarPairs(const FeatureMatrix &features, float maxDistance, size_t minLag,
+                                           const mfccKernels<double> &kernels) {
+    std::vector<SimilarPair> pairs;
+    std::vector<double> dots(features.rows());
+    size_t lag = std::max(minLag, (size_t) 1);
+    for (size_t i=lag; i<features.rows(); i++) {
+        size_t count = i - lag + 1;
+        kernels.dotRows(features.row(i), features.row(0), features.stride(), features.stride(), count, dots.data());
+        for (size_t j=0; j<count; j++) {
+            float distance = float(1 - dots[j]);
+            if (distance <= maxDistance) {
+                SimilarPair pair = { i, j, distance };
+                pairs.push_back(pair);
+            }
+        }
+    }
+    return pairs;
+}
@@ -0,0 +1,76 @@
+#ifndef REPETITIONINDEX
+#define REPETITIONINDEX
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "similaritymatrix.h"
+
+// Frames i > j with their self-similarity measure 1 - cos
+struct SimilarPair {
+    size_t  i;
+    size_t  j;
+    float   distance;
+};
+
+// Frames [first, first + length) come back as [repeat, repeat + length), repeat > first
+struct RepeatedSegment {
+    size_t  first;
+    size_t  repeat;
+    size_t  length;
+};
+
+/**
+ * Locality-sensitive hashing index over the normalised frames of a FeatureMatrix, for repetition search in recordings
+ * far too long for a matrix. Each of numTables tables hashes a frame to the signs of its dot products with bitsPerTable
+ * random hyperplanes. Frames at a small angle agree in most signs, so similar frames share a bucket in at least one
+ * table with a probability that grows with numTables and shrinks with bitsPerTable: more tables raise the recall, more
+ * bits cut the candidates to verify. The frames are centred on their mean before hashing, MFCC frames lie in a narrow
+ * cone around it that hyperplanes through the origin would hardly split.
+ *
+ * Building sorts every table, O(N log N), and the candidates are verified with their exact measure, so no false
+ * pairs are reported. Frames in one bucket are only paired with the maxBucket frames following them, which bounds
+ * the work on buckets of near-identical frames such as silence.
+ */
+class RepetitionIndex
+{
+public:
+    RepetitionIndex(size_t numTables = 12, size_t bitsPerTable = 16, uint32_t seed = 1);
+
+    void build(const FeatureMatrix &features, const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+    // Pairs with a measure of at most maxDistance and at least minLag frames apart, sorted by (i, j)
+    std::vector<SimilarPair> similarPairs(const FeatureMatrix &features, float maxDistance, size_t minLag,
+                                          size_t maxBucket = 64,
+                                          const mfccKernels<double> &kernels = mfccKernelsDetected<double>()) const;
+
+    /* Repeated segments as runs of pairs along one diagonal i - j, gaps of up to maxGap frames left by the hashing
+     * or by single dissimilar frames are bridged. Segments shorter than minLength frames are dropped.
+     */
+    static std::vector<RepeatedSegment> repeatedSegments(const std::vector<SimilarPair> &pairs, size_t minLength,
+                                                         size_t maxGap = 4);
+
+    size_t numTables() const { return tables; }
+    size_t bitsPerTable() const { return bits; }
+
+private:
+    struct Entry {
+        uint64_t    key;
+        uint32_t    frame;
+        bool operator<(const Entry &other) const { return key < other.key || (key == other.key && frame < other.frame); }
+    };
+
+    size_t                              tables;
+    size_t                              bits;
+    size_t                              stride;
+    uint32_t                            seed;
+    std::vector<double>                 planes;         // tables * bits hyperplanes, stride values each
+    std::vector<std::vector<Entry>>     entries;        // Frames of each table sorted by bucket
+};
+
+// Exact search over all pairs with kernels.dotRows, the O(N^2) reference of RepetitionIndex::similarPairs
+std::vector<SimilarPair> exactSimilarPairs(const FeatureMatrix &features, float maxDistance, size_t minLag,
+                                           const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+#endif // REPETITIONINDEX
@@ -1,5 +1,8 @@
 #include "restful.h"
 #include "fftw3.h"
+#include "mfccextractor.h"
+
+#include <QMutex>
 
 extern QVector<qreal> levelsAll;
 extern QVector<qreal> levelsSpectrum;
@@ -57,13 +60,20 @@ void RestfulWorker::levelsFingerprint()
         out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * n_out);
 
         // plan, real to complex, one dimension, speed of the computation, FFTW_ESTIMATE means as fast as possible
-        plan_forward = fftw_plan_dft_r2c_1d(bufferSize, in, out, FFTW_ESTIMATE);
+        // the planner is shared with the MFCC plans of other threads
+        {
+            QMutexLocker locker(&fftwPlannerMutex());
+            plan_forward = fftw_plan_dft_r2c_1d(bufferSize, in, out, FFTW_ESTIMATE);
+        }
 
         // fft is computed here
         fftw_execute(plan_forward);
 
         // release memory associated with the plan
-        fftw_destroy_plan(plan_forward);
+        {
+            QMutexLocker locker(&fftwPlannerMutex());
+            fftw_destroy_plan(plan_forward);
+        }
 
         int nFreqSamples = bufferSize / 2;
         double y[1000];
@@ -5,10 +5,13 @@
 #include <complex>
 #include <fstream>
 #include <vector>
-#include <map>
 #include <math.h>
 
+#include <QAtomicInt>
 #include <QDebug>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
 
 /* As introduced to the music information retrieval world by Jonathan Foote (2000), self-similarity matrices
  * turn multi-dimensional feature vectors from an audio signal into a clear and easily-readable 2-dimensional image. This is
@@ -16,47 +19,24 @@
  * vectors can contain STFT values, MFCCs, chroma vectors, or any other musical feature of choice. The width of the frames
  * determines the resolution of the resultant self-similarity matrix.
  *
- * MFCC feature vectors calculation is based on D S Pavan Kumar's MFCC Feature Extractor using C++ STL and C++11. Thank you.
- * Please check the following github repository: https://github.com/dspavankumar/compute-mfcc.
+ * The MFCC feature vectors are computed by MfccExtractor, see mfccextractor.cpp.
  */
 
 typedef std::vector<double> v_d;
-typedef std::complex<double> c_d;
-typedef std::vector<v_d> v_v_d;
-typedef std::vector<c_d> v_c_d;
-typedef std::map<int, std::map<int, c_d>> twmap;
 
-const double PI = 4*atan(1.0);
-size_t winWidthSamples, frameShiftSamples, numFFTBins;
-std::vector<double> frame, prevSamples, powerSpectralCoef, lmfbCoef, hamming, mfcc;
-std::vector<std::vector<double>> vecdmfcc, fbank, dct;
-std::map<int, std::map<int, std::complex<double>>> twiddle;
+std::vector<std::vector<double>> vecdmfcc;
 
 extern QVector<qint16> levels;
 
-extern std::vector<double> vecdsimilarity;
+extern PackedSimilarityMatrix<float> similarityMatrix;
+extern BandedSimilarityMatrix<float> bandedSimilarity;
+extern SimilarityFile similarityFile;
+extern SimilarityPyramid similarityPyramid;
 
-SelfSimilarity::SelfSimilarity(QObject *parent) : QObject(parent)
+SelfSimilarity::SelfSimilarity(QObject *parent)
+    : QObject(parent), inputConfig(extractor.config()), analysisRate(0), featureDeltas(extractor.numStaticFeatures()),
+      maxLag(0), similarityFileMinFrames(0), similarityFileFrames(0), onlineSamples(0), onlineLevels(0)
 {
-    fs = 44100;                 // Sampling rate in Hertz (default=16000)
-    numCepstral = 12;           // Number of output cepstra, excluding log-energy (default=12)
-    numFilters = 40;            // Number of Mel warped filters in filterbank (default=40)
-    preEmphCoef = 0.97;         // Pre-emphasis coefficient
-    lowFreq = 50;               // Filterbank low frequency cutoff in Hertz (default=50)
-    highFreq = 4000;            // Filterbank high freqency cutoff in Hertz (default=fs/2)
-    numFFT = 512;               // N-point FFT on each frame
-    winWidth = 25;              // Width of analysis window in milliseconds (default=25)
-    frameShift = 10;            // Frame shift in milliseconds (default=10)
-
-    winWidthSamples = winWidth * fs / 1000;
-    frameShiftSamples = frameShift * fs / 1000;
-    numFFTBins = numFFT / 2 + 1;
-    powerSpectralCoef.assign(numFFTBins, 0);
-    prevSamples.assign(winWidthSamples - frameShiftSamples, 0);
-
-    initFilterbank();
-    initHammingDct();
-    compTwiddle();
 }
 
 SelfSimilarity::~SelfSimilarity()
@@ -64,13 +44,13 @@ SelfSimilarity::~SelfSimilarity()
 }
 
 // Calculate cosine similarity between two vectors
-double SelfSimilarity::cosine_similarity(std::vector<double> veca, std::vector<double> vecb) {
+double SelfSimilarity::cosine_similarity(const std::vector<double> &veca, const std::vector<double> &vecb) {
 
     double multiply = 0.0;
     double d_a = 0.0;
     double d_b = 0.0;
 
-    std::vector<double>::iterator itera, iterb;
+    std::vector<double>::const_iterator itera, iterb;
 
     for (itera = veca.begin(), iterb = vecb.begin(); itera != veca.end(); itera++, iterb++) {
         multiply += *itera * *iterb;
@@ -81,71 +61,264 @@ double SelfSimilarity::cosine_similarity(std::vector<double> veca, std::vector<d
     return multiply / (sqrt(d_a) * sqrt(d_b));
 }
 
-// Process each frame and return MFCCs as vector of double
-std::vector<double> SelfSimilarity::processFrameTo(int16_t* samples, size_t N) {
-    // Add samples from the previous frame that overlap with the current frame to the current samples and create the frame.
-    frame = prevSamples;
-    for (size_t i=0; i<N; i++)
-        frame.push_back(samples[i]);
-    prevSamples.assign(frame.begin()+frameShiftSamples, frame.end());
+// Process each frame and return MFCCs as vector of double, N must be the frame shift
+// The vector belongs to the extractor and is overwritten by the next frame, nothing is allocated per frame
+const std::vector<double>& SelfSimilarity::processFrameTo(const int16_t* samples, size_t N) {
+    Q_ASSERT(N == extractor.shiftSamples());
+    if (!fixedPointFrames())
+        return extractor.processFrame(samples);
+
+    const std::vector<int32_t> &mfcc = fixedPointExtractor->processFrame(samples);
+    for (size_t i=0; i<mfcc.size(); i++)
+        fixedPointFrame[i] = mfcc[i] / double(1 << FixedPointMfcc::mfccFracBits);
+    return fixedPointFrame;
+}
 
-    preEmphHamming();
-    compPowerSpec();
-    applyLogMelFilterbank();
-    applyDct();
+void SelfSimilarity::setOverlap(const int16_t* samples) {
+    extractor.setOverlap(samples);
+    if (fixedPointExtractor)
+        fixedPointExtractor->setOverlap(samples);
+}
 
-    return mfcc;
+// Process a block of consecutive frames, see MfccExtractor::processBlock
+void SelfSimilarity::processBlockTo(const int16_t* samples, size_t numFrames, std::vector<std::vector<double>> &mfccs) {
+    if (fixedPointFrames())
+        fixedPointExtractor->processBlock(samples, numFrames, mfccs);
+    else
+        extractor.processBlock(samples, numFrames, mfccs);
 }
 
-// Read samples, extract MFCCs and calculate self-similarity measures
-int SelfSimilarity::processSamplesTo() {
-    uint16_t bufferLength = winWidthSamples - frameShiftSamples;
-    uint16_t position = bufferLength;
+/* Parallel extraction
+ * A frame only depends on its own samples, so extraction can start at any frame given the overlapSamples() samples
+ * in front of it. The frames are cut into chunks of blockFrames and every worker pulls chunks from a shared counter
+ * until none are left, which keeps all cores busy even when some run slower. Each worker owns an extractor and
+ * writes its frames straight into their final slots. The block kernels work frame by frame, so the MFCCs are
+ * bit-identical to processBlockTo however the frames are chunked. The spectral flux also needs the frame in front of
+ * a chunk, which is then extracted again and dropped. The task runs MfccExtractor<double> or FixedPointMfcc workers.
+ */
+template <typename Extractor>
+class MfccChunkTask : public QRunnable
+{
+public:
+    MfccChunkTask(Extractor* extractor, const int16_t* samples, size_t numFrames, bool continued,
+                  std::vector<double>* mfccs, QAtomicInt* nextChunk, QSemaphore* done)
+        : extractor(extractor), samples(samples), numFrames(numFrames), continued(continued), mfccs(mfccs),
+          nextChunk(nextChunk), done(done) {}
+
+    void run() {
+        const size_t chunkFrames = MfccExtractor<double>::blockFrames;
+        std::vector<std::vector<double>> chunk;
+        chunk.reserve(chunkFrames);
+        for (;;) {
+            size_t first = (size_t) nextChunk->fetchAndAddRelaxed(1) * chunkFrames;
+            if (first >= numFrames)
+                break;
+            size_t count = std::min(chunkFrames, numFrames - first);
+            size_t previous = needsPreviousFrame(extractor) && (first > 0 || continued) ? 1 : 0;
+            // Signed steps, the previous frame of the first chunk of a continued call lies in front of samples
+            const int16_t* start = samples + first * extractor->shiftSamples() - previous * extractor->shiftSamples();
+
+            chunk.clear();
+            extractor->setOverlap(start);
+            extractor->processBlock(start + extractor->overlapSamples(), count + previous, chunk);
+            for (size_t k=0; k<count; k++)
+                mfccs[first + k].swap(chunk[previous + k]);
+        }
+        done->release();
+    }
 
-    // Read and set the initial samples
-    for (int i=0; i<bufferLength; i++)
-        prevSamples[i] = levels[i];
+private:
+    static bool needsPreviousFrame(const MfccExtractor<double>* extractor) { return extractor->needsPreviousFrame(); }
+    static bool needsPreviousFrame(const FixedPointMfcc*) { return false; }
+
+    Extractor*                          extractor;
+    const int16_t*                      samples;
+    size_t                              numFrames;
+    bool                                continued;
+    std::vector<double>*                mfccs;
+    QAtomicInt*                         nextChunk;
+    QSemaphore*                         done;
+};
+
+// Extract numFrames frames on the global thread pool and append them to mfccs, in order
+// samples holds overlapSamples() + numFrames * shiftSamples() samples, the overlap first. When continued, the
+// shiftSamples() samples in front of them belong to the same recording.
+void SelfSimilarity::processParallelTo(const int16_t* samples, size_t numFrames, std::vector<std::vector<double>> &mfccs,
+                                       bool continued) {
+    size_t numChunks = (numFrames + MfccExtractor<double>::blockFrames - 1) / MfccExtractor<double>::blockFrames;
+    size_t numWorkers = std::min((size_t) std::max(QThreadPool::globalInstance()->maxThreadCount(), 1), numChunks);
+
+    size_t base = mfccs.size();
+    mfccs.resize(base + numFrames);
+
+    QAtomicInt nextChunk(0);
+    QSemaphore done;
+    if (fixedPointFrames()) {
+        // Every worker computes the integer tables of the configuration once
+        while (fixedPointWorkers.size() < numWorkers)
+            fixedPointWorkers.emplace_back(new FixedPointMfcc());
+        for (size_t i=0; i<numWorkers; i++) {
+            if (fixedPointWorkers[i]->config() != extractor.config())
+                fixedPointWorkers[i]->configure(extractor.config());
+            QThreadPool::globalInstance()->start(new MfccChunkTask<FixedPointMfcc>(fixedPointWorkers[i].get(), samples,
+                                                 numFrames, continued, mfccs.data() + base, &nextChunk, &done));
+        }
+        done.acquire(numWorkers);
+        return;
+    }
 
-    // Initialise buffer (allocate a block of memory of type int16_t, dynamically allocated memory is allocated on Heap^)
-    bufferLength = frameShiftSamples;
-    int16_t* buffer = new int16_t[bufferLength];
+    // The workers share the plan of the extractor's configuration, creating them costs no tables
+    while (workers.size() < numWorkers)
+        workers.emplace_back(new MfccExtractor<double>(extractor.sampleRate()));
+
+    for (size_t i=0; i<numWorkers; i++) {
+        if (workers[i]->config() != extractor.config())
+            workers[i]->configure(extractor.config());
+        workers[i]->setSpectrumBackend(extractor.spectrumBackend());
+        workers[i]->setKernels(extractor.activeKernels());
+        if (workers[i]->spectralFeatures() != extractor.spectralFeatures())
+            workers[i]->setSpectralFeatures(extractor.spectralFeatures());
+        QThreadPool::globalInstance()->start(new MfccChunkTask<MfccExtractor<double>>(workers[i].get(), samples,
+                                             numFrames, continued, mfccs.data() + base, &nextChunk, &done));
+    }
+    done.acquire(numWorkers);
+}
 
-    // Allocate memory for 790 coefficients, read data and process each frame
-    vecdmfcc.reserve(790);
-    vecdmfcc.clear();
+// Empty the features and both matrices, the one of the current mode is filled again by computeSimilarity
+// The next processSamplesTo starts over as well
+void SelfSimilarity::resetSimilarity() {
+    restartOnline();
+    features.clear();
+    similarityMatrix.resize(0);
+    bandedSimilarity.reset(maxLag);
+    similarityFile.close();
+    similarityFileFrames = 0;
+    similarityPyramid.clear();
+    noveltyCurve.reset();
+    featureDeltas.reset();
+}
+
+void SelfSimilarity::setSampleRate(size_t fs) {
+    inputConfig.fs = fs;
+    configureAnalysis();
+}
 
-    for (int i=0; i<bufferLength; i++)
-        buffer[i] = levels[position+i];
-    position += bufferLength;
+void SelfSimilarity::setAnalysisRate(size_t fs) {
+    analysisRate = fs;
+    configureAnalysis();
+}
 
-    while (position < levels.count() && vecdmfcc.size() < 790) {
-        vecdmfcc.push_back(processFrameTo(buffer, bufferLength));
-        for (int i=0; i<bufferLength; i++)
-            buffer[i] = levels[position+i];
-        position += bufferLength;
+/* Analysis rate
+ * The window and the frame shift are given in milliseconds and scale with the rate by themselves, the FFT is the
+ * smallest power of two that holds the window. The decimator passes the band of the Mel filterbank. The analysis
+ * plan of the rate comes from the plan cache, spectral features and deltas keep their settings.
+ */
+void SelfSimilarity::configureAnalysis() {
+    MfccConfig config = inputConfig;
+    if (decimating()) {
+        config.fs = analysisRate;
+        config.numFFT = 1;
+        while (config.numFFT < config.winWidth * analysisRate / 1000)
+            config.numFFT *= 2;
+        decimator = PolyphaseDecimator(inputConfig.fs, analysisRate, config.highFreq);
+    }
+    if (config != extractor.config())
+        extractor.configure(config);
+    if (fixedPointExtractor && config != fixedPointExtractor->config()) {
+        fixedPointExtractor->configure(config);
+        fixedPointFrame.assign(fixedPointExtractor->numCoefficients(), 0);
     }
+    restartOnline();
+}
 
-    // Allocate memory for self-similarity measures
-    vecdsimilarity.reserve(365 * 790);
-    vecdsimilarity.clear();
-    std::vector<double> veca, vecb;
-    double measure;
-    for (size_t j=0; j<365; j++) {
-        veca = vecdmfcc[j];
-        for (size_t i=j; i<790; i++) {
-            vecb = vecdmfcc[i];
-            measure = 1 - cosine_similarity(veca, vecb);
-            vecdsimilarity.push_back(measure);
-        }
+void SelfSimilarity::setFixedPoint(bool enable) {
+    if (enable && !fixedPointExtractor) {
+        fixedPointExtractor.reset(new FixedPointMfcc());
+        fixedPointExtractor->configure(extractor.config());
+        fixedPointFrame.assign(fixedPointExtractor->numCoefficients(), 0);
+    } else if (!enable) {
+        fixedPointExtractor.reset();
+        fixedPointWorkers.clear();
     }
+    restartOnline();
+}
 
-    delete [] buffer;
-    buffer = nullptr;
-    return 0;
+// The MFCCs of vecdmfcc stay static, the deltas only reach the features
+void SelfSimilarity::setDeltaOrder(size_t order, size_t window) {
+    extractor.setDeltaOrder(order, window);
+    featureDeltas = DeltaFilter<double>(extractor.numStaticFeatures(), order, window, extractor.activeKernels());
+    restartOnline();
 }
 
-// Read input file stream, extract MFCCs and calculate self-similarity measures
-int SelfSimilarity::processTo(std::ifstream &wavFp) {
+// The features grow by the spectral features, the deltas cover them as well
+void SelfSimilarity::setSpectralFeatures(unsigned features) {
+    extractor.setSpectralFeatures(features);
+    featureDeltas = DeltaFilter<double>(extractor.numStaticFeatures(), featureDeltas.order(), featureDeltas.window(),
+                                        extractor.activeKernels());
+    restartOnline();
+}
+
+// The pyramid is pooled again with the next frames
+void SelfSimilarity::setPyramidPooling(SimilarityPooling pooling) {
+    similarityPyramid.setPooling(pooling);
+    restartOnline();
+}
+
+std::vector<RepeatedSegment> SelfSimilarity::findRepetitions(float maxDistance, size_t minLength, size_t minLag) const {
+    RepetitionIndex index;
+    index.build(features, extractor.activeKernels());
+    return RepetitionIndex::repeatedSegments(index.similarPairs(features, maxDistance, minLag, 64,
+                                                                extractor.activeKernels()), minLength);
+}
+
+// Add the MFCCs of vecdmfcc from firstFrame on to the normalised features and calculate their self-similarity
+// measures against all frames, or against the band in banded mode. The measures of the earlier frames are kept.
+// The last frames wait for their deltas until more frames follow, or until the recording is complete.
+void SelfSimilarity::computeSimilarity(size_t firstFrame, bool complete) {
+    for (size_t i=firstFrame; i<vecdmfcc.size(); i++) {
+        if (const std::vector<double>* frame = featureDeltas.push(vecdmfcc[i].data()))
+            features.append(frame->data(), frame->size());
+    }
+    while (complete) {
+        const std::vector<double>* frame = featureDeltas.flush();
+        if (!frame)
+            break;
+        features.append(frame->data(), frame->size());
+    }
+
+    if (maxLag > 0) {
+        extendBandedSimilarityParallel(features, bandedSimilarity, extractor.activeKernels());
+        noveltyCurve.update(bandedSimilarity);
+    } else if (!similarityFileName.isEmpty() && features.rows() >= similarityFileMinFrames) {
+        computeSimilarityFile();
+        similarityPyramid.update(similarityFile);
+    } else {
+        extendSimilarityMatrixParallel(features, similarityMatrix, extractor.activeKernels());
+        similarityPyramid.update(similarityMatrix);
+    }
+}
+
+// Out-of-core mode: the matrix in memory is dropped and the file is written, or extended when it holds the first
+// frames already. similarityFile maps it again afterwards. Past SimilarityFile::maxFrames() the file is not extended
+// and keeps showing the frames it holds.
+void SelfSimilarity::computeSimilarityFile() {
+    if (similarityFileFrames > 0 && features.rows() > SimilarityFile::maxFrames())
+        return;
+    if (similarityFileFrames == 0)
+        similarityPyramid.clear();
+    similarityFile.close();
+    similarityMatrix = PackedSimilarityMatrix<float>();
+
+    bool written = similarityFileFrames > 0
+            ? extendSimilarityFile(similarityFileName, features, extractor.activeKernels())
+            : writeSimilarityFile(similarityFileName, features, extractor.activeKernels());
+    similarityFileFrames = written ? features.rows() : 0;
+    if (written)
+        similarityFile.open(similarityFileName);
+}
+
+// Read the wav header, check that the extractor supports the format and switch it to the sampling rate of the file
+int SelfSimilarity::readWavHeader(std::ifstream &wavFp) {
     // Read the wav header
     wavHeader hdr;
     int headerSize = sizeof(wavHeader);
@@ -156,59 +329,176 @@ int SelfSimilarity::processTo(std::ifstream &wavFp) {
         qDebug() << "Unsupported audio format, use 16 bit PCM Wave";
         return 1;
     }
-    // Check sampling rate
-    if (hdr.SamplesPerSec != fs) {
-        qDebug() << "Sampling rate mismatch: Found" << hdr.SamplesPerSec << "instead of" << fs;
+    // Check sampling rate, a frame shift has to hold at least one sample
+    if (hdr.SamplesPerSec < 100) {
+        qDebug() << "Unsupported sampling rate" << hdr.SamplesPerSec;
         return 1;
     }
+    if (hdr.SamplesPerSec != inputConfig.fs)
+        setSampleRate(hdr.SamplesPerSec);
+    return 0;
+}
 
-    // Initialise buffer (allocate a block of memory of type int16_t, dynamically allocated memory is allocated on Heap^)
-    uint16_t bufferLength = winWidthSamples - frameShiftSamples;
-    int16_t* buffer = new int16_t[bufferLength];
-    // Calculate bytes per sample (size of the first element in bytes)
-    int bufferBPS = (sizeof buffer[0]);
-    qDebug() << bufferLength;
+/* Read samples, extract MFCCs and calculate self-similarity measures
+ * While a recording goes on levels only grows. The frames processed by the last call keep their MFCCs and measures,
+ * only the frames completed since then are extracted and compared against all frames, so a refresh costs O(N) per
+ * new frame instead of O(N^2). levels is taken for a new recording, and processed from its start again, when it got
+ * shorter or when its first samples or the overlap at the end of the processed part changed.
+ */
+int SelfSimilarity::processSamplesTo() {
+    size_t overlapLength = extractor.overlapSamples();
+    size_t numSamples = levels.count();
+    if (numSamples < overlapLength)
+        return 1;
 
-    // Read and set the initial samples
-    wavFp.read((char *) buffer, bufferLength*bufferBPS);    // cast the pointer of the int16_t variable to a pointer to characters/bytes
-    for (int i=0; i<bufferLength; i++) {
-        prevSamples[i] = buffer[i];                         // prevSamples[i] is an ith element of std::vector<double>
-        qDebug() << prevSamples[i];
+    if (onlineSamples == 0 || numSamples < onlineLevels
+            || !std::equal(onlineEdges.begin(), onlineEdges.begin() + overlapLength, levels.constBegin())
+            || !std::equal(onlineEdges.begin() + overlapLength, onlineEdges.end(), levels.constBegin() + onlineLevels - overlapLength)) {
+        vecdmfcc.clear();
+        resetSimilarity();
+        onlineSamples = overlapLength;
+        onlineLevels = 0;
+        analysisLevels.clear();
+        decimator.reset();
     }
-    delete [] buffer;
 
-    // Recalculate buffer size
-    bufferLength = frameShiftSamples;
-    buffer = new int16_t[bufferLength];
+    // With decimation all new samples of levels pass the decimator, the frames are cut from its output
+    const int16_t* samples = levels.constData();
+    if (decimating()) {
+        decimator.process(levels.constData() + onlineLevels, numSamples - onlineLevels, analysisLevels);
+        onlineLevels = numSamples;
+        samples = analysisLevels.data();
+        numSamples = analysisLevels.size();
+    }
+
+    // Process the new frames on all cores, the overlap in front of them is read from the samples again
+    size_t firstFrame = vecdmfcc.size();
+    size_t numFrames = numSamples < onlineSamples ? 0 : (numSamples - onlineSamples) / extractor.shiftSamples();
+    processParallelTo(samples + onlineSamples - overlapLength, numFrames, vecdmfcc, firstFrame > 0);
+    onlineSamples += numFrames * extractor.shiftSamples();
+    if (!decimating())
+        onlineLevels = onlineSamples;
+
+    onlineEdges.assign(levels.constBegin(), levels.constBegin() + overlapLength);
+    onlineEdges.insert(onlineEdges.end(), levels.constBegin() + onlineLevels - overlapLength, levels.constBegin() + onlineLevels);
+
+    computeSimilarity(firstFrame, false);
+
+    return 0;
+}
+
+// Read input file stream, extract MFCCs and calculate self-similarity measures
+int SelfSimilarity::processTo(std::ifstream &wavFp) {
+    if (readWavHeader(wavFp))
+        return 1;
+
+    // Read all samples, in chunks of about a second
+    size_t overlapLength = extractor.overlapSamples();
+    qDebug() << overlapLength;
+    std::vector<int16_t> buffer;
+    size_t numSamples = 0;
+    while (wavFp) {
+        buffer.resize(numSamples + extractor.sampleRate());
+        wavFp.read((char *) (buffer.data() + numSamples), extractor.sampleRate() * sizeof(int16_t));
+        numSamples += wavFp.gcount() / sizeof(int16_t);
+    }
+
+    // Decimate to the analysis rate before framing
+    const int16_t* samples = buffer.data();
+    if (decimating()) {
+        analysisSamples.clear();
+        decimator.reset();
+        decimator.process(buffer.data(), numSamples, analysisSamples);
+        samples = analysisSamples.data();
+        numSamples = analysisSamples.size();
+    }
+    size_t numFrames = numSamples < overlapLength ? 0 : (numSamples - overlapLength) / extractor.shiftSamples();
 
-    // Allocate memory for 790 coefficients, read data and process each frame
-    vecdmfcc.reserve(790);
+    // Process the frames on all cores
     vecdmfcc.clear();
-    wavFp.read((char *) buffer, bufferLength*bufferBPS);
-    while (wavFp.gcount() == bufferLength*bufferBPS && !wavFp.eof() && vecdmfcc.size() < 790) {
-        vecdmfcc.push_back(processFrameTo(buffer, bufferLength));
-        wavFp.read((char *) buffer, bufferLength*bufferBPS);
+    processParallelTo(samples, numFrames, vecdmfcc);
+
+    resetSimilarity();
+    computeSimilarity(0, true);
+
+    return 0;
+}
+
+// Start a new stream, the first samples pushed become the overlap of the first frame
+// In banded mode the measures of every frame are appended to bandedSimilarity as soon as the frame is complete
+void SelfSimilarity::startStream(const MfccExtractor<double>::FrameCallback &callback) {
+    extractor.resetStream();
+    decimator.reset();
+    if (maxLag == 0) {
+        streamCallback = callback;
+        return;
     }
 
-    // Allocate memory for self-similarity measures
-    vecdsimilarity.reserve(365 * 790);
-    vecdsimilarity.clear();
-    std::vector<double> veca, vecb;
-    double measure;
-    for (size_t j=0; j<365; j++) {
-        veca = vecdmfcc[j];
-        for (size_t i=j; i<790; i++) {
-            vecb = vecdmfcc[i];
-            measure = 1 - cosine_similarity(veca, vecb);
-            vecdsimilarity.push_back(measure);
-        }
+    resetSimilarity();
+    bandedStream.reset(bandedSimilarity, maxLag);
+    streamCallback = [this, callback](const std::vector<double> &mfcc) {
+        bandedStream.push(mfcc.data(), mfcc.size(), bandedSimilarity, extractor.activeKernels());
+        noveltyCurve.update(bandedSimilarity);
+        if (callback)
+            callback(mfcc);
+    };
+}
+
+// Add samples of the stream, any chunk size
+void SelfSimilarity::pushSamples(const int16_t* samples, size_t n) {
+    if (!decimating()) {
+        extractor.pushSamples(samples, n, streamCallback);
+        return;
     }
+    analysisSamples.clear();
+    decimator.process(samples, n, analysisSamples);
+    extractor.pushSamples(analysisSamples.data(), analysisSamples.size(), streamCallback);
+}
 
-    delete [] buffer;
-    buffer = nullptr;
+void SelfSimilarity::finishStream() {
+    extractor.finishStream(streamCallback);
+}
+
+// Read input file stream chunk by chunk and report the MFCCs of every frame, memory use does not grow with the file
+// Push the remaining samples of the file to the stream
+void SelfSimilarity::pushFile(std::ifstream &wavFp) {
+    std::vector<int16_t> buffer(4096);
+    while (wavFp) {
+        wavFp.read((char *) buffer.data(), buffer.size() * sizeof(int16_t));
+        pushSamples(buffer.data(), wavFp.gcount() / sizeof(int16_t));
+    }
+}
+
+int SelfSimilarity::processStream(std::ifstream &wavFp, const MfccExtractor<double>::FrameCallback &callback) {
+    if (readWavHeader(wavFp))
+        return 1;
+
+    startStream(callback);
+    pushFile(wavFp);
+    finishStream();
     return 0;
 }
 
+// Read input file stream, extract the features of the stream and write them to a binary feature file
+int SelfSimilarity::processToFile(std::ifstream &wavFp, const QString &fileName, FeatureFileFormat format) {
+    if (readWavHeader(wavFp))
+        return 1;
+
+    FeatureFileInfo info;
+    info.config = extractor.config();
+    info.dims = extractor.numFeatures();
+    info.deltaOrder = extractor.deltaOrder();
+    info.spectralFeatures = extractor.spectralFeatures();
+    FeatureFileWriter writer;
+    if (!writer.open(fileName, info, format))
+        return 1;
+
+    startStream([&writer](const std::vector<double> &features) { writer.write(features.data()); });
+    pushFile(wavFp);
+    finishStream();
+    return writer.close() ? 0 : 1;
+}
+
 // Convert vector of double to string
 std::string v_d_to_string (v_d vec) {
     // The class template std::basic_stringstream implements operations on memory based streams.
@@ -224,52 +514,35 @@ std::string v_d_to_string (v_d vec) {
 
 // Process each frame and extract MFCCs as string
 std::string SelfSimilarity::processFrame(int16_t* samples, size_t N) {
-    // Add samples from the previous frame that overlap with the current frame to the current samples and create the frame.
-    frame = prevSamples;
-    for (size_t i=0; i<N; i++)
-        frame.push_back(samples[i]);
-    prevSamples.assign(frame.begin()+frameShiftSamples, frame.end());
-
-    preEmphHamming();
-    compPowerSpec();
-    applyLogMelFilterbank();
-    applyDct();
-
-    return v_d_to_string(mfcc);
+    return v_d_to_string(processFrameTo(samples, N));
 }
 
 // Read input file stream, extract MFCCs and write to output file stream
 int SelfSimilarity::process(std::ifstream &wavFp, std::ofstream &mfcFp) {
-    // Read the wav header
-    wavHeader hdr;
-    int headerSize = sizeof(wavHeader);
-    wavFp.read((char *) &hdr, headerSize); // cast the address of hdr, denoted &hdr, to a char *, i.e. a pointer to characters/bytes
-
-    // Check audio format
-    if (hdr.AudioFormat != 1 || hdr.bitsPerSample != 16) {
-        qDebug() << "Unsupported audio format, use 16 bit PCM Wave";
-        return 1;
-    }
-    // Check sampling rate
-    if (hdr.SamplesPerSec != fs) {
-        qDebug() << "Sampling rate mismatch: Found" << hdr.SamplesPerSec << "instead of" << fs;
+    if (readWavHeader(wavFp))
         return 1;
+
+    // Frames of decimated samples do not line up with the frames of the file, they pass the stream
+    if (decimating()) {
+        startStream([&mfcFp](const std::vector<double> &mfcc) { mfcFp << v_d_to_string(mfcc); });
+        pushFile(wavFp);
+        finishStream();
+        return 0;
     }
 
     // Initialise buffer (allocate a block of memory of type int16_t, dynamically allocated memory is allocated on Heap^)
-    uint16_t bufferLength = winWidthSamples - frameShiftSamples;
+    uint16_t bufferLength = extractor.overlapSamples();
     int16_t* buffer = new int16_t[bufferLength];
     // Calculate bytes per sample (size of the first element in bytes)
     int bufferBPS = (sizeof buffer[0]);
 
     // Read and set the initial samples
     wavFp.read((char *) buffer, bufferLength*bufferBPS);    // cast the pointer of the int16_t variable to a pointer to characters/bytes
-    for (int i=0; i<bufferLength; i++)
-        prevSamples[i] = buffer[i];                         // prevSamples[i] is an ith element of std::vector<double>
+    setOverlap(buffer);
     delete [] buffer;
 
     // Recalculate buffer size
-    bufferLength = frameShiftSamples;
+    bufferLength = extractor.shiftSamples();
     buffer = new int16_t[bufferLength];
 
     // Read data and process each frame
@@ -283,188 +556,3 @@ int SelfSimilarity::process(std::ifstream &wavFp, std::ofstream &mfcFp) {
     buffer = nullptr;
     return 0;
 }
-
-// ***** Conversion functions and FFT recursive function *****
-
-// Hertz to Mel conversion
-inline double Hz2Mel(double f) {
-    return 2595*std::log10(1 + f/700);
-}
-
-// Mel to Hertz conversion
-inline double Mel2Hz(double m) {
-    return 700*(std::pow(10, m/2595) - 1);
-}
-
-// Cooley-Tukey FFT recursive function
-std::vector<std::complex<double>> fft(std::vector<std::complex<double>> x) {
-    size_t N = x.size();
-    if (N==1)
-        return x;
-
-    std::vector<std::complex<double>> xe(N/2,0), xo(N/2,0), Xjo, Xjo2;
-
-    // Construct arrays from even and odd indices
-    for (size_t i=0; i<N; i+=2)
-        xe[i/2] = x[i];
-    for (size_t i=1; i<N; i+=2)
-        xo[(i-1)/2] = x[i];
-
-    // Compute N/2-point FFT
-    Xjo = fft(xe);
-    Xjo2 = fft(xo);
-    Xjo.insert (Xjo.end(), Xjo2.begin(), Xjo2.end());
-
-    // Butterfly computations
-    for (size_t i=0; i<=N/2-1; i++) {
-        c_d t = Xjo[i], tw = twiddle[N][i];
-        Xjo[i] = t + tw * Xjo[i+N/2];
-        Xjo[i+N/2] = t - tw * Xjo[i+N/2];
-    }
-    return Xjo;
-}
-
-// ***** Frame processing routines *****
-
-/* Pre-emphasis and Hamming window
- * The first step is to apply a pre-emphasis filter on the signal to amplify the high frequencies.
- * A pre-emphasis filter is useful in several ways: (1) balance the frequency spectrum since high frequencies
- * usually have smaller magnitudes compared to lower frequencies, (2) avoid numerical problems during the
- * Fourier transform operation and (3) may also improve the Signal-to-Noise Ratio (SNR).
- * The pre-emphasis filter can be applied to a signal x using the first order filter in the following equation: y(t)=x(t)−αx(t−1).
- */
-void SelfSimilarity::preEmphHamming(void) {
-    v_d procFrame(frame.size(), hamming[0]*frame[0]);
-    for (size_t i=1; i<frame.size(); i++)
-        procFrame[i] = hamming[i] * (frame[i] - preEmphCoef * frame[i-1]);
-    frame = procFrame;
-}
-
-/* Power spectrum computation
- * After pre-emphasis, we need to split the signal into short-time frames. We can safely assume that frequencies in a signal
- * are stationary over a very short period of time. Therefore, by doing a Fourier transform over this short-time frame,
- * we can obtain a good approximation of the frequency contours of the signal by concatenating adjacent frames.
- *
- * We can now do an N-point FFT on each frame to calculate the frequency spectrum, which is also called Short-Time
- * Fourier-Transform, where N is typically 256 or 512, numFFT = 512 in this case; and then compute the power spectrum (periodogram)
- * using the following equation: P=|FFT(xi)|^2 where, xi is the ith frame of signal x.
- */
-void SelfSimilarity::compPowerSpec(void) {
-    frame.resize(numFFT); // Pads zeros
-    v_c_d framec (frame.begin(), frame.end()); // Complex frame
-    v_c_d fftc = fft(framec);
-
-    for (size_t i=0; i<numFFTBins; i++)
-        powerSpectralCoef[i] = pow(abs(fftc[i]),2);
-}
-
-/* Applying log Mel filterbank
- * The final step to computing filter banks is applying triangular filters, typically 40 filters, numFilters = 40 on a Mel-scale
- * to the power spectrum to extract frequency bands. The Mel-scale aims to mimic the non-linear human ear perception of sound,
- * by being more discriminative at lower frequencies and less discriminative at higher frequencies.
- */
-void SelfSimilarity::applyLogMelFilterbank(void) {
-    lmfbCoef.assign(numFilters,0);
-
-    for (size_t i=0; i<numFilters; i++) {
-        // Multiply the filterbank matrix
-        for (size_t j=0; j<fbank[i].size(); j++)
-            lmfbCoef[i] += fbank[i][j] * powerSpectralCoef[j];
-        // Apply Mel-flooring
-        if (lmfbCoef[i] < 1.0)
-            lmfbCoef[i] = 1.0;
-    }
-
-    // Applying log on amplitude
-    for (size_t i=0; i<numFilters; i++)
-        lmfbCoef[i] = std::log(lmfbCoef[i]);
-}
-
-/* Computing discrete cosine transform
- * It turns out that filter bank coefficients computed in the previous step are highly correlated, which could be
- * problematic in some machine learning algorithms. Therefore, we can apply Discrete Cosine Transform (DCT)
- * to decorrelate the filter bank coefficients and yield a compressed representation of the filter banks. Typically,
- * for Automatic Speech Recognition (ASR), the resulting cepstral coefficients 2-13 are retained and the rest are discarded.
- */
-void SelfSimilarity::applyDct(void) {
-    mfcc.assign(numCepstral+1,0);
-    for (size_t i=0; i<=numCepstral; i++) {
-        for (size_t j=0; j<numFilters; j++)
-            mfcc[i] += dct[i][j] * lmfbCoef[j];
-    }
-}
-
-// ***** Initialisation routines *****
-
-// Precompute filterbank
-void SelfSimilarity::initFilterbank () {
-    // Convert low and high frequencies to Mel scale
-    double lowFreqMel = Hz2Mel(lowFreq);
-    double highFreqMel = Hz2Mel(highFreq);
-
-    // Calculate filter centre-frequencies
-    v_d filterCentreFreq;
-    filterCentreFreq.reserve(numFilters+2);
-    for (size_t i=0; i<numFilters+2; i++)
-        filterCentreFreq.push_back(Mel2Hz(lowFreqMel + (highFreqMel-lowFreqMel)/(numFilters+1)*i));
-
-    // Calculate FFT bin frequencies
-    v_d fftBinFreq;
-    fftBinFreq.reserve(numFFTBins);
-    for (size_t i=0; i<numFFTBins; i++)
-        fftBinFreq.push_back(fs/2.0/(numFFTBins-1)*i);
-
-    // Allocate memory for the filterbank
-    fbank.reserve(numFilters*numFFTBins);
-
-    // Populate the filterbank matrix
-    for (size_t filt=1; filt<=numFilters; filt++) {
-        v_d ftemp;
-        for (size_t bin=0; bin<numFFTBins; bin++) {
-            double weight;
-            if (fftBinFreq[bin] < filterCentreFreq[filt-1])
-                weight = 0;
-            else if (fftBinFreq[bin] <= filterCentreFreq[filt])
-                weight = (fftBinFreq[bin] - filterCentreFreq[filt-1]) / (filterCentreFreq[filt] - filterCentreFreq[filt-1]);
-            else if (fftBinFreq[bin] <= filterCentreFreq[filt+1])
-                weight = (filterCentreFreq[filt+1] - fftBinFreq[bin]) / (filterCentreFreq[filt+1] - filterCentreFreq[filt]);
-            else
-                weight = 0;
-            ftemp.push_back(weight);
-        }
-        fbank.push_back(ftemp);
-    }
-}
-
-// Precompute Hamming window and dct matrix
-void SelfSimilarity::initHammingDct(void) {
-    size_t i, j;
-
-    // After slicing the signal into frames, we apply a window function such as the Hamming window to each frame.
-    hamming.assign(winWidthSamples, 0);
-    for (i=0; i<winWidthSamples; i++)
-        hamming[i] = 0.54 - 0.46 * cos(2 * PI * i / (winWidthSamples-1));
-
-    v_d v1(numCepstral+1,0), v2(numFilters,0);
-    for (i=0; i <= numCepstral; i++)
-        v1[i] = i;
-    for (i=0; i < numFilters; i++)
-        v2[i] = i + 0.5;
-
-    dct.reserve(numFilters*(numCepstral+1));
-    double c = sqrt(2.0/numFilters);
-    for (i=0; i<=numCepstral; i++) {
-        v_d dtemp;
-        for (j=0; j<numFilters; j++)
-            dtemp.push_back(c * cos(PI / numFilters * v1[i] * v2[j]));
-        dct.push_back(dtemp);
-    }
-}
-
-// Twiddle factor computation
-void SelfSimilarity::compTwiddle(void) {
-    const std::complex<double> J(0,1);
-    for (size_t n=2; n<=numFFT; n*=2)
-        for (size_t k=0; k<=n/2-1; k++)
-            twiddle[n][k] = exp(-2*PI*k/n*J);
-}
@@ -3,6 +3,18 @@
 
 #include <QCoreApplication>
 
+#include <memory>
+
+#include "decimator.h"
+#include "featurefile.h"
+#include "fixedpointmfcc.h"
+#include "mfccextractor.h"
+#include "noveltycurve.h"
+#include "repetitionindex.h"
+#include "similarityfile.h"
+#include "similaritymatrix.h"
+#include "similaritypyramid.h"
+
 class SelfSimilarity : public QObject
 {
     Q_OBJECT
@@ -11,33 +23,143 @@ public:
     SelfSimilarity(QObject *parent = 0);
     ~SelfSimilarity();
 
+    // Sampling rate of the samples, processTo and processStream take the rate of the file
+    void setSampleRate(size_t fs);
+    size_t sampleRate() const { return inputConfig.fs; }
+    // Decimate the samples to rate ahead of the MFCCs, which halves the work from 44.1 to 16 kHz and scales window,
+    // frame shift and FFT along. 0 or a rate not below the sampling rate analyses at the sampling rate.
+    void setAnalysisRate(size_t rate);
+    size_t analysisSampleRate() const { return extractor.sampleRate(); }
+
+    // Spectral backend used by the power spectrum
+    void setSpectrumBackend(SpectrumBackend backend) { extractor.setSpectrumBackend(backend); }
+    SpectrumBackend spectrumBackend() const { return extractor.spectrumBackend(); }
+
+    // Kernels of the MFCC hot loops, the delta features and the similarity measures, detected from the CPU features at
+    // construction. The pipeline runs in double, which 32-bit ARM cannot vectorise: there mfccKernelsDetected<double>()
+    // is the scalar set.
+    void setKernels(const mfccKernels<double> &kernels) {
+        extractor.setKernels(kernels);
+        featureDeltas.setKernels(kernels);
+    }
+    // Float kernels of the novelty curve
+    void setKernels(const mfccKernels<float> &kernels) { noveltyCurve.setKernels(kernels); }
+
+    // Extract the MFCCs of processFrameTo, processBlockTo, processParallelTo, processTo, processSamplesTo and process
+    // with FixedPointMfcc, for units without a usable FPU. The streams, the feature files, the decimator and frames
+    // with spectral features stay floating point. Off by default.
+    void setFixedPoint(bool enable);
+    bool fixedPoint() const { return fixedPointExtractor != nullptr; }
+
+    // SpectralFeature flags of chroma, spectral shape and RMS features appended to the MFCCs of every frame and
+    // compared along with them. They come from the power spectrum of the MFCCs, no further FFT is needed.
+    void setSpectralFeatures(unsigned features);
+
+    // Deltas (order 1) or deltas and delta-deltas (order 2) over window frames appended to the MFCCs of the features
+    // and the streams. They are computed as the frames arrive, so a frame is compared once the window frames of each
+    // order after it are known. 0 compares the MFCCs alone, the default.
+    void setDeltaOrder(size_t order, size_t window = 2);
+
+    // Banded mode for long recordings: only frames at most maxLag frames apart are compared, into bandedSimilarity
+    // instead of similarityMatrix. 0 selects the full matrix, the default.
+    void setMaxLag(size_t frames) { maxLag = frames; restartOnline(); }
+    size_t maxLagFrames() const { return maxLag; }
+
+    // Out-of-core mode: a full matrix of minFrames frames or more is written to the tiled file fileName, mapped by
+    // similarityFile, instead of being kept in similarityMatrix. An empty name keeps every matrix in memory, the default.
+    void setSimilarityFile(const QString &fileName, size_t minFrames = 8192) {
+        similarityFileName = fileName;
+        similarityFileMinFrames = minFrames;
+        restartOnline();
+    }
+
+    // Pooling of similarityPyramid, built from the full matrix for zoomed out display
+    void setPyramidPooling(SimilarityPooling pooling);
+
+    // Foote novelty of the frames, followed in banded mode when maxLag is at least 2*halfWidth - 1
+    void setNoveltyHalfWidth(size_t halfWidth) {
+        noveltyCurve = NoveltyCurve(halfWidth, 0.5, noveltyCurve.activeKernels());
+        restartOnline();
+    }
+    const NoveltyCurve& novelty() const { return noveltyCurve; }
+
+    // Repeated segments of at least minLength frames among the frames of the last processTo or processSamplesTo,
+    // found through a RepetitionIndex in any mode and at any length, without a full matrix
+    std::vector<RepeatedSegment> findRepetitions(float maxDistance, size_t minLength, size_t minLag) const;
+
 public:
     std::string processFrame(int16_t* samples, size_t N);
     int process (std::ifstream &wavFp, std::ofstream &mfcFp);
-    double cosine_similarity(std::vector<double> veca, std::vector<double> vecb);
-    std::vector<double> processFrameTo(int16_t* samples, size_t N);
+    double cosine_similarity(const std::vector<double> &veca, const std::vector<double> &vecb);
+    // Samples per frame shift and overlap of the analysis, and the overlapSamples() samples in front of the first frame
+    // of processFrameTo and processBlockTo
+    size_t shiftSamples() const { return extractor.shiftSamples(); }
+    size_t overlapSamples() const { return extractor.overlapSamples(); }
+    void setOverlap(const int16_t* samples);
+    const std::vector<double>& processFrameTo(const int16_t* samples, size_t N);
+    void processBlockTo(const int16_t* samples, size_t numFrames, std::vector<std::vector<double>> &mfccs);
+    void processParallelTo(const int16_t* samples, size_t numFrames, std::vector<std::vector<double>> &mfccs,
+                           bool continued = false);
     int processTo(std::ifstream &wavFp);
     int processSamplesTo();
+    // Make the next processSamplesTo start over with the first sample of levels
+    void restartOnline() { onlineSamples = 0; }
+
+    // Streaming extraction without a length limit, callback receives the MFCCs of every completed frame
+    void startStream(const MfccExtractor<double>::FrameCallback &callback);
+    void pushSamples(const int16_t* samples, size_t n);
+    // End the stream, the last frames are reported once their deltas are known
+    void finishStream();
+    int processStream(std::ifstream &wavFp, const MfccExtractor<double>::FrameCallback &callback);
+    // Write the features of the stream to a binary feature file, the compact and fast replacement of process
+    int processToFile(std::ifstream &wavFp, const QString &fileName, FeatureFileFormat format = NativeFeatureFile);
 
 private:
-    void preEmphHamming(void);
-    void compPowerSpec(void);
-    void applyLogMelFilterbank(void);
-    void applyDct(void);
-    void initFilterbank();
-    void initHammingDct(void);
-    void compTwiddle(void);
-
-    size_t      fs;
-    size_t      numCepstral;
-    size_t      numFilters;
-    size_t      numFFT;
-    size_t      winWidth;
-    size_t      frameShift;
-    double      preEmphCoef;
-    double      lowFreq;
-    double      highFreq;
+    int readWavHeader(std::ifstream &wavFp);
+    void pushFile(std::ifstream &wavFp);
+    void resetSimilarity();
+    void computeSimilarity(size_t firstFrame, bool complete);
+    void computeSimilarityFile();
+    void configureAnalysis();
+    bool decimating() const { return analysisRate > 0 && analysisRate < inputConfig.fs; }
+    // FixedPointMfcc computes the MFCCs alone, frames with spectral features take the floating point extractor
+    bool fixedPointFrames() const { return fixedPointExtractor && extractor.spectralFeatures() == 0; }
+
+    MfccExtractor<double> extractor;
+    MfccExtractor<double>::FrameCallback streamCallback;
+
+    // Configuration at the sampling rate of the input, and the decimator to analysisRate in front of the extractor
+    MfccConfig inputConfig;
+    size_t analysisRate;
+    PolyphaseDecimator decimator;
+    std::vector<int16_t> analysisSamples;       // Decimated samples of processTo and pushSamples
+
+    // Integer-only extractor of setFixedPoint, configured along with extractor, and its frame in double
+    std::unique_ptr<FixedPointMfcc> fixedPointExtractor;
+    std::vector<double> fixedPointFrame;
+
+    // One extractor per worker of processParallelTo, created on first use
+    std::vector<std::unique_ptr<MfccExtractor<double>>> workers;
+    std::vector<std::unique_ptr<FixedPointMfcc>> fixedPointWorkers;
+
+    // Normalised MFCCs of the frames behind similarityMatrix, with the deltas of featureDeltas
+    FeatureMatrix features;
+    DeltaFilter<double> featureDeltas;
+
+    size_t maxLag;
+    BandedSimilarityStream<float> bandedStream;
+    NoveltyCurve noveltyCurve;
+
+    QString similarityFileName;
+    size_t similarityFileMinFrames;
+    size_t similarityFileFrames;        // Frames written to the file, 0 without one
 
+    // Samples processed by processSamplesTo, and copies of the first and last overlapSamples() of levels. While
+    // decimating, onlineLevels samples of levels were decimated to analysisLevels and onlineSamples counts those.
+    size_t onlineSamples;
+    size_t onlineLevels;
+    std::vector<int16_t> onlineEdges;
+    std::vector<int16_t> analysisLevels;
 };
 
 struct wavHeader {
@@ -0,0 +1,642 @@
+#include "simdkernels.h"
+
+#include <QDebug>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_NEON
+#if defined(__aarch64__)
+#define SIMD_NEON64
+#else
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+// ***** Scalar reference *****
+
+template <typename T>
+static void preEmphHammingScalar(const T* in, const T* window, T coef, T* out, size_t n) {
+    if (n == 0)
+        return;
+    out[0] = window[0] * in[0];
+    for (size_t i=1; i<n; i++)
+        out[i] = window[i] * (in[i] - coef * in[i-1]);
+}
+
+template <typename T>
+static void powerSpectrumScalar(const T* spectrum, T* power, size_t n) {
+    for (size_t i=0; i<n; i++)
+        power[i] = spectrum[2*i] * spectrum[2*i] + spectrum[2*i+1] * spectrum[2*i+1];
+}
+
+template <typename T>
+static T dotScalar(const T* a, const T* b, size_t n) {
+    T sum = 0;
+    for (size_t i=0; i<n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+template <typename T>
+static void axpyScalar(T w, const T* x, T* acc, size_t n) {
+    for (size_t i=0; i<n; i++)
+        acc[i] += w * x[i];
+}
+
+template <typename T>
+static void dotRowsScalar(const T* a, const T* rows, size_t stride, size_t n, size_t numRows, T* out) {
+    for (size_t c=0; c<numRows; c++)
+        out[c] = dotScalar(a, rows + c*stride, n);
+}
+
+// dotRows from a single-row dot, for the kernel sets without a dedicated multi-row version
+template <typename T, T (*dot)(const T*, const T*, size_t)>
+static void dotRowsWith(const T* a, const T* rows, size_t stride, size_t n, size_t numRows, T* out) {
+    for (size_t c=0; c<numRows; c++)
+        out[c] = dot(a, rows + c*stride, n);
+}
+
+// ***** SSE2 and AVX2 (x86), double *****
+// Compiled with per-function target attributes, so the rest of the program does not need -mavx2 and still runs on older CPUs.
+
+#ifdef SIMD_X86
+
+__attribute__((target("sse2")))
+static void preEmphHammingSSE2(const double* in, const double* window, double coef, double* out, size_t n) {
+    if (n == 0)
+        return;
+    out[0] = window[0] * in[0];
+    const __m128d c = _mm_set1_pd(coef);
+    size_t i = 1;
+    for (; i+2<=n; i+=2) {
+        __m128d x = _mm_loadu_pd(in + i);
+        __m128d xp = _mm_loadu_pd(in + i - 1);
+        __m128d w = _mm_loadu_pd(window + i);
+        _mm_storeu_pd(out + i, _mm_mul_pd(w, _mm_sub_pd(x, _mm_mul_pd(c, xp))));
+    }
+    for (; i<n; i++)
+        out[i] = window[i] * (in[i] - coef * in[i-1]);
+}
+
+__attribute__((target("sse2")))
+static void powerSpectrumSSE2(const double* spectrum, double* power, size_t n) {
+    size_t i = 0;
+    for (; i+2<=n; i+=2) {
+        __m128d a = _mm_loadu_pd(spectrum + 2*i);       // re0, im0
+        __m128d b = _mm_loadu_pd(spectrum + 2*i + 2);   // re1, im1
+        a = _mm_mul_pd(a, a);
+        b = _mm_mul_pd(b, b);
+        _mm_storeu_pd(power + i, _mm_add_pd(_mm_unpacklo_pd(a, b), _mm_unpackhi_pd(a, b)));
+    }
+    for (; i<n; i++)
+        power[i] = spectrum[2*i] * spectrum[2*i] + spectrum[2*i+1] * spectrum[2*i+1];
+}
+
+__attribute__((target("sse2")))
+static double dotSSE2(const double* a, const double* b, size_t n) {
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i+4<=n; i+=4) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    s0 = _mm_add_pd(s0, s1);
+    double lanes[2];
+    _mm_storeu_pd(lanes, s0);
+    double sum = lanes[0] + lanes[1];
+    for (; i<n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("sse2")))
+static void axpySSE2(double w, const double* x, double* acc, size_t n) {
+    const __m128d wv = _mm_set1_pd(w);
+    size_t i = 0;
+    for (; i+2<=n; i+=2)
+        _mm_storeu_pd(acc + i, _mm_add_pd(_mm_loadu_pd(acc + i), _mm_mul_pd(wv, _mm_loadu_pd(x + i))));
+    for (; i<n; i++)
+        acc[i] += w * x[i];
+}
+
+/* Multi-row dot products
+ * Four rows at a time share the loads of a and keep four independent accumulators in flight. Every row is summed
+ * in one accumulator and reduced as lane 0 + lane 1, the same order as a single remaining row, so a result does
+ * not depend on how many rows are processed together.
+ */
+__attribute__((target("sse2")))
+static void dotRowsSSE2(const double* a, const double* rows, size_t stride, size_t n, size_t numRows, double* out) {
+    size_t nv = n / 2 * 2;
+    size_t c = 0;
+    for (; c+4<=numRows; c+=4) {
+        const double* b0 = rows + c*stride;
+        const double* b1 = b0 + stride;
+        const double* b2 = b1 + stride;
+        const double* b3 = b2 + stride;
+        __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd(), s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+        for (size_t i=0; i<nv; i+=2) {
+            __m128d x = _mm_loadu_pd(a + i);
+            s0 = _mm_add_pd(s0, _mm_mul_pd(x, _mm_loadu_pd(b0 + i)));
+            s1 = _mm_add_pd(s1, _mm_mul_pd(x, _mm_loadu_pd(b1 + i)));
+            s2 = _mm_add_pd(s2, _mm_mul_pd(x, _mm_loadu_pd(b2 + i)));
+            s3 = _mm_add_pd(s3, _mm_mul_pd(x, _mm_loadu_pd(b3 + i)));
+        }
+        _mm_storeu_pd(out + c, _mm_add_pd(_mm_unpacklo_pd(s0, s1), _mm_unpackhi_pd(s0, s1)));
+        _mm_storeu_pd(out + c + 2, _mm_add_pd(_mm_unpacklo_pd(s2, s3), _mm_unpackhi_pd(s2, s3)));
+        for (size_t i=nv; i<n; i++) {
+            out[c] += a[i] * b0[i];
+            out[c+1] += a[i] * b1[i];
+            out[c+2] += a[i] * b2[i];
+            out[c+3] += a[i] * b3[i];
+        }
+    }
+    for (; c<numRows; c++) {
+        const double* b = rows + c*stride;
+        __m128d s = _mm_setzero_pd();
+        for (size_t i=0; i<nv; i+=2)
+            s = _mm_add_pd(s, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        double lanes[2];
+        _mm_storeu_pd(lanes, s);
+        double sum = lanes[0] + lanes[1];
+        for (size_t i=nv; i<n; i++)
+            sum += a[i] * b[i];
+        out[c] = sum;
+    }
+}
+
+__attribute__((target("avx2")))
+static void preEmphHammingAVX2(const double* in, const double* window, double coef, double* out, size_t n) {
+    if (n == 0)
+        return;
+    out[0] = window[0] * in[0];
+    const __m256d c = _mm256_set1_pd(coef);
+    size_t i = 1;
+    for (; i+4<=n; i+=4) {
+        __m256d x = _mm256_loadu_pd(in + i);
+        __m256d xp = _mm256_loadu_pd(in + i - 1);
+        __m256d w = _mm256_loadu_pd(window + i);
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(w, _mm256_sub_pd(x, _mm256_mul_pd(c, xp))));
+    }
+    for (; i<n; i++)
+        out[i] = window[i] * (in[i] - coef * in[i-1]);
+}
+
+__attribute__((target("avx2")))
+static void powerSpectrumAVX2(const double* spectrum, double* power, size_t n) {
+    size_t i = 0;
+    for (; i+4<=n; i+=4) {
+        __m256d a = _mm256_loadu_pd(spectrum + 2*i);        // re0, im0, re1, im1
+        __m256d b = _mm256_loadu_pd(spectrum + 2*i + 4);    // re2, im2, re3, im3
+        __m256d p = _mm256_hadd_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b));  // p0, p2, p1, p3
+        _mm256_storeu_pd(power + i, _mm256_permute4x64_pd(p, 0xD8));
+    }
+    for (; i<n; i++)
+        power[i] = spectrum[2*i] * spectrum[2*i] + spectrum[2*i+1] * spectrum[2*i+1];
+}
+
+__attribute__((target("avx2")))
+static double dotAVX2(const double* a, const double* b, size_t n) {
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i+8<=n; i+=8) {
+        s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    for (; i+4<=n; i+=4)
+        s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    s0 = _mm256_add_pd(s0, s1);
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(s0), _mm256_extractf128_pd(s0, 1));
+    double lanes[2];
+    _mm_storeu_pd(lanes, s);
+    double sum = lanes[0] + lanes[1];
+    for (; i<n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static void axpyAVX2(double w, const double* x, double* acc, size_t n) {
+    const __m256d wv = _mm256_set1_pd(w);
+    size_t i = 0;
+    for (; i+4<=n; i+=4)
+        _mm256_storeu_pd(acc + i, _mm256_add_pd(_mm256_loadu_pd(acc + i), _mm256_mul_pd(wv, _mm256_loadu_pd(x + i))));
+    for (; i<n; i++)
+        acc[i] += w * x[i];
+}
+
+// Same scheme as dotRowsSSE2, every row is reduced as (lane 0 + lane 1) + (lane 2 + lane 3)
+__attribute__((target("avx2")))
+static void dotRowsAVX2(const double* a, const double* rows, size_t stride, size_t n, size_t numRows, double* out) {
+    size_t nv = n / 4 * 4;
+    size_t c = 0;
+    for (; c+4<=numRows; c+=4) {
+        const double* b0 = rows + c*stride;
+        const double* b1 = b0 + stride;
+        const double* b2 = b1 + stride;
+        const double* b3 = b2 + stride;
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+        for (size_t i=0; i<nv; i+=4) {
+            __m256d x = _mm256_loadu_pd(a + i);
+            s0 = _mm256_add_pd(s0, _mm256_mul_pd(x, _mm256_loadu_pd(b0 + i)));
+            s1 = _mm256_add_pd(s1, _mm256_mul_pd(x, _mm256_loadu_pd(b1 + i)));
+            s2 = _mm256_add_pd(s2, _mm256_mul_pd(x, _mm256_loadu_pd(b2 + i)));
+            s3 = _mm256_add_pd(s3, _mm256_mul_pd(x, _mm256_loadu_pd(b3 + i)));
+        }
+        __m256d h01 = _mm256_hadd_pd(s0, s1);                  // s0 01, s1 01, s0 23, s1 23
+        __m256d h23 = _mm256_hadd_pd(s2, s3);                  // s2 01, s3 01, s2 23, s3 23
+        __m256d lo = _mm256_permute2f128_pd(h01, h23, 0x20);   // lanes 0 + 1 of the four rows
+        __m256d hi = _mm256_permute2f128_pd(h01, h23, 0x31);   // lanes 2 + 3 of the four rows
+        _mm256_storeu_pd(out + c, _mm256_add_pd(lo, hi));
+        for (size_t i=nv; i<n; i++) {
+            out[c] += a[i] * b0[i];
+            out[c+1] += a[i] * b1[i];
+            out[c+2] += a[i] * b2[i];
+            out[c+3] += a[i] * b3[i];
+        }
+    }
+    for (; c<numRows; c++) {
+        const double* b = rows + c*stride;
+        __m256d s = _mm256_setzero_pd();
+        for (size_t i=0; i<nv; i+=4)
+            s = _mm256_add_pd(s, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        double lanes[4];
+        _mm256_storeu_pd(lanes, s);
+        double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        for (size_t i=nv; i<n; i++)
+            sum += a[i] * b[i];
+        out[c] = sum;
+    }
+}
+
+// ***** SSE2 and AVX2 (x86), float *****
+
+__attribute__((target("sse2")))
+static void preEmphHammingSSE2(const float* in, const float* window, float coef, float* out, size_t n) {
+    if (n == 0)
+        return;
+    out[0] = window[0] * in[0];
+    const __m128 c = _mm_set1_ps(coef);
+    size_t i = 1;
+    for (; i+4<=n; i+=4) {
+        __m128 x = _mm_loadu_ps(in + i);
+        __m128 xp = _mm_loadu_ps(in + i - 1);
+        __m128 w = _mm_loadu_ps(window + i);
+        _mm_storeu_ps(out + i, _mm_mul_ps(w, _mm_sub_ps(x, _mm_mul_ps(c, xp))));
+    }
+    for (; i<n; i++)
+        out[i] = window[i] * (in[i] - coef * in[i-1]);
+}
+
+__attribute__((target("sse2")))
+static void powerSpectrumSSE2(const float* spectrum, float* power, size_t n) {
+    size_t i = 0;
+    for (; i+4<=n; i+=4) {
+        __m128 a = _mm_loadu_ps(spectrum + 2*i);        // re0, im0, re1, im1
+        __m128 b = _mm_loadu_ps(spectrum + 2*i + 4);    // re2, im2, re3, im3
+        a = _mm_mul_ps(a, a);
+        b = _mm_mul_ps(b, b);
+        __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(power + i, _mm_add_ps(re, im));
+    }
+    for (; i<n; i++)
+        power[i] = spectrum[2*i] * spectrum[2*i] + spectrum[2*i+1] * spectrum[2*i+1];
+}
+
+__attribute__((target("sse2")))
+static float dotSSE2(const float* a, const float* b, size_t n) {
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i+8<=n; i+=8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    s0 = _mm_add_ps(s0, s1);
+    float lanes[4];
+    _mm_storeu_ps(lanes, s0);
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i<n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("sse2")))
+static void axpySSE2(float w, const float* x, float* acc, size_t n) {
+    const __m128 wv = _mm_set1_ps(w);
+    size_t i = 0;
+    for (; i+4<=n; i+=4)
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(wv, _mm_loadu_ps(x + i))));
+    for (; i<n; i++)
+        acc[i] += w * x[i];
+}
+
+__attribute__((target("avx2")))
+static void preEmphHammingAVX2(const float* in, const float* window, float coef, float* out, size_t n) {
+    if (n == 0)
+        return;
+    out[0] = window[0] * in[0];
+    const __m256 c = _mm256_set1_ps(coef);
+    size_t i = 1;
+    for (; i+8<=n; i+=8) {
+        __m256 x = _mm256_loadu_ps(in + i);
+        __m256 xp = _mm256_loadu_ps(in + i - 1);
+        __m256 w = _mm256_loadu_ps(window + i);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(w, _mm256_sub_ps(x, _mm256_mul_ps(c, xp))));
+    }
+    for (; i<n; i++)
+        out[i] = window[i] * (in[i] - coef * in[i-1]);
+}
+
+__attribute__((target("avx2")))
+static void powerSpectrumAVX2(const float* spectrum, float* power, size_t n) {
+    size_t i = 0;
+    for (; i+8<=n; i+=8) {
+        __m256 a = _mm256_loadu_ps(spectrum + 2*i);         // bins 0..3, interleaved
+        __m256 b = _mm256_loadu_ps(spectrum + 2*i + 8);     // bins 4..7, interleaved
+        __m256 p = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));  // p0, p1, p4, p5, p2, p3, p6, p7
+        p = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(p), 0xD8));
+        _mm256_storeu_ps(power + i, p);
+    }
+    for (; i<n; i++)
+        power[i] = spectrum[2*i] * spectrum[2*i] + spectrum[2*i+1] * spectrum[2*i+1];
+}
+
+__attribute__((target("avx2")))
+static float dotAVX2(const float* a, const float* b, size_t n) {
+    __m256 s0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i+16<=n; i+=16) {
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    for (; i+8<=n; i+=8)
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    s0 = _mm256_add_ps(s0, s1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(s0), _mm256_extractf128_ps(s0, 1));
+    float lanes[4];
+    _mm_storeu_ps(lanes, s);
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i<n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static void axpyAVX2(float w, const float* x, float* acc, size_t n) {
+    const __m256 wv = _mm256_set1_ps(w);
+    size_t i = 0;
+    for (; i+8<=n; i+=8)
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(wv, _mm256_loadu_ps(x + i))));
+    for (; i<n; i++)
+        acc[i] += w * x[i];
+}
+
+#endif // SIMD_X86
+
+// ***** NEON (AArch64), double *****
+// ARMv7 NEON, as on the Cortex-A9 of the Apalis iMX6, has no double-precision lanes, there the scalar kernels are used.
+
+#ifdef SIMD_NEON64
+
+static void preEmphHammingNEON(const double* in, const double* window, double coef, double* out, size_t n) {
+    if (n == 0)
+        return;
+    out[0] = window[0] * in[0];
+    const float64x2_t c = vdupq_n_f64(coef);
+    size_t i = 1;
+    for (; i+2<=n; i+=2) {
+        float64x2_t x = vld1q_f64(in + i);
+        float64x2_t xp = vld1q_f64(in + i - 1);
+        float64x2_t w = vld1q_f64(window + i);
+        vst1q_f64(out + i, vmulq_f64(w, vsubq_f64(x, vmulq_f64(c, xp))));
+    }
+    for (; i<n; i++)
+        out[i] = window[i] * (in[i] - coef * in[i-1]);
+}
+
+static void powerSpectrumNEON(const double* spectrum, double* power, size_t n) {
+    size_t i = 0;
+    for (; i+2<=n; i+=2) {
+        float64x2x2_t z = vld2q_f64(spectrum + 2*i);       // deinterleaved re, im
+        vst1q_f64(power + i, vaddq_f64(vmulq_f64(z.val[0], z.val[0]), vmulq_f64(z.val[1], z.val[1])));
+    }
+    for (; i<n; i++)
+        power[i] = spectrum[2*i] * spectrum[2*i] + spectrum[2*i+1] * spectrum[2*i+1];
+}
+
+static double dotNEON(const double* a, const double* b, size_t n) {
+    float64x2_t s0 = vdupq_n_f64(0.0);
+    float64x2_t s1 = vdupq_n_f64(0.0);
+    size_t i = 0;
+    for (; i+4<=n; i+=4) {
+        s0 = vaddq_f64(s0, vmulq_f64(vld1q_f64(a + i), vld1q_f64(b + i)));
+        s1 = vaddq_f64(s1, vmulq_f64(vld1q_f64(a + i + 2), vld1q_f64(b + i + 2)));
+    }
+    double sum = vaddvq_f64(vaddq_f64(s0, s1));
+    for (; i<n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+static void axpyNEON(double w, const double* x, double* acc, size_t n) {
+    const float64x2_t wv = vdupq_n_f64(w);
+    size_t i = 0;
+    for (; i+2<=n; i+=2)
+        vst1q_f64(acc + i, vaddq_f64(vld1q_f64(acc + i), vmulq_f64(wv, vld1q_f64(x + i))));
+    for (; i<n; i++)
+        acc[i] += w * x[i];
+}
+
+// Same scheme as dotRowsSSE2, every row is reduced as lane 0 + lane 1
+static void dotRowsNEON(const double* a, const double* rows, size_t stride, size_t n, size_t numRows, double* out) {
+    size_t nv = n / 2 * 2;
+    size_t c = 0;
+    for (; c+4<=numRows; c+=4) {
+        const double* b0 = rows + c*stride;
+        const double* b1 = b0 + stride;
+        const double* b2 = b1 + stride;
+        const double* b3 = b2 + stride;
+        float64x2_t s0 = vdupq_n_f64(0.0), s1 = vdupq_n_f64(0.0), s2 = vdupq_n_f64(0.0), s3 = vdupq_n_f64(0.0);
+        for (size_t i=0; i<nv; i+=2) {
+            float64x2_t x = vld1q_f64(a + i);
+            s0 = vaddq_f64(s0, vmulq_f64(x, vld1q_f64(b0 + i)));
+            s1 = vaddq_f64(s1, vmulq_f64(x, vld1q_f64(b1 + i)));
+            s2 = vaddq_f64(s2, vmulq_f64(x, vld1q_f64(b2 + i)));
+            s3 = vaddq_f64(s3, vmulq_f64(x, vld1q_f64(b3 + i)));
+        }
+        vst1q_f64(out + c, vpaddq_f64(s0, s1));
+        vst1q_f64(out + c + 2, vpaddq_f64(s2, s3));
+        for (size_t i=nv; i<n; i++) {
+            out[c] += a[i] * b0[i];
+            out[c+1] += a[i] * b1[i];
+            out[c+2] += a[i] * b2[i];
+            out[c+3] += a[i] * b3[i];
+        }
+    }
+    for (; c<numRows; c++) {
+        const double* b = rows + c*stride;
+        float64x2_t s = vdupq_n_f64(0.0);
+        for (size_t i=0; i<nv; i+=2)
+            s = vaddq_f64(s, vmulq_f64(vld1q_f64(a + i), vld1q_f64(b + i)));
+        double sum = vaddvq_f64(s);
+        for (size_t i=nv; i<n; i++)
+            sum += a[i] * b[i];
+        out[c] = sum;
+    }
+}
+
+#endif // SIMD_NEON64
+
+// ***** NEON (ARMv7 and AArch64), float *****
+// ARMv7 NEON flushes denormals to zero, for such tiny values the results can differ from the scalar kernels.
+
+#ifdef SIMD_NEON
+
+static void preEmphHammingNEON(const float* in, const float* window, float coef, float* out, size_t n) {
+    if (n == 0)
+        return;
+    out[0] = window[0] * in[0];
+    const float32x4_t c = vdupq_n_f32(coef);
+    size_t i = 1;
+    for (; i+4<=n; i+=4) {
+        float32x4_t x = vld1q_f32(in + i);
+        float32x4_t xp = vld1q_f32(in + i - 1);
+        float32x4_t w = vld1q_f32(window + i);
+        vst1q_f32(out + i, vmulq_f32(w, vsubq_f32(x, vmulq_f32(c, xp))));
+    }
+    for (; i<n; i++)
+        out[i] = window[i] * (in[i] - coef * in[i-1]);
+}
+
+static void powerSpectrumNEON(const float* spectrum, float* power, size_t n) {
+    size_t i = 0;
+    for (; i+4<=n; i+=4) {
+        float32x4x2_t z = vld2q_f32(spectrum + 2*i);       // deinterleaved re, im
+        vst1q_f32(power + i, vaddq_f32(vmulq_f32(z.val[0], z.val[0]), vmulq_f32(z.val[1], z.val[1])));
+    }
+    for (; i<n; i++)
+        power[i] = spectrum[2*i] * spectrum[2*i] + spectrum[2*i+1] * spectrum[2*i+1];
+}
+
+static float dotNEON(const float* a, const float* b, size_t n) {
+    float32x4_t s0 = vdupq_n_f32(0.0f);
+    float32x4_t s1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i+8<=n; i+=8) {
+        s0 = vaddq_f32(s0, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+        s1 = vaddq_f32(s1, vmulq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4)));
+    }
+    s0 = vaddq_f32(s0, s1);
+    float32x2_t s = vadd_f32(vget_low_f32(s0), vget_high_f32(s0));
+    s = vpadd_f32(s, s);
+    float sum = vget_lane_f32(s, 0);
+    for (; i<n; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+static void axpyNEON(float w, const float* x, float* acc, size_t n) {
+    const float32x4_t wv = vdupq_n_f32(w);
+    size_t i = 0;
+    for (; i+4<=n; i+=4)
+        vst1q_f32(acc + i, vaddq_f32(vld1q_f32(acc + i), vmulq_f32(wv, vld1q_f32(x + i))));
+    for (; i<n; i++)
+        acc[i] += w * x[i];
+}
+
+#endif // SIMD_NEON
+
+// ***** Dispatch *****
+
+#ifdef SIMD_X86
+static bool cpuHasAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static bool cpuHasSSE2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+#endif
+
+#ifdef SIMD_NEON
+static bool cpuHasNEON() {
+#ifdef SIMD_NEON64
+    return true;                                    // Advanced SIMD is mandatory on AArch64
+#else
+    return getauxval(AT_HWCAP) & HWCAP_NEON;        // Optional on ARMv7, ask the kernel
+#endif
+}
+#endif
+
+template <typename T>
+const mfccKernels<T>& mfccKernelsScalar() {
+    static const mfccKernels<T> kernels = { "scalar", preEmphHammingScalar<T>, powerSpectrumScalar<T>, dotScalar<T>, axpyScalar<T>,
+                                            dotRowsScalar<T> };
+    return kernels;
+}
+
+static const mfccKernels<double>& detectKernels(const double*) {
+#ifdef SIMD_X86
+    static const mfccKernels<double> avx2 = { "AVX2", preEmphHammingAVX2, powerSpectrumAVX2, dotAVX2, axpyAVX2, dotRowsAVX2 };
+    static const mfccKernels<double> sse2 = { "SSE2", preEmphHammingSSE2, powerSpectrumSSE2, dotSSE2, axpySSE2, dotRowsSSE2 };
+    if (cpuHasAVX2())
+        return avx2;
+    if (cpuHasSSE2())
+        return sse2;
+#endif
+#ifdef SIMD_NEON64
+    static const mfccKernels<double> neon = { "NEON", preEmphHammingNEON, powerSpectrumNEON, dotNEON, axpyNEON, dotRowsNEON };
+    return neon;
+#endif
+    return mfccKernelsScalar<double>();
+}
+
+static const mfccKernels<float>& detectKernels(const float*) {
+#ifdef SIMD_X86
+    static const mfccKernels<float> avx2 = { "AVX2", preEmphHammingAVX2, powerSpectrumAVX2, dotAVX2, axpyAVX2,
+                                             dotRowsWith<float, dotAVX2> };
+    static const mfccKernels<float> sse2 = { "SSE2", preEmphHammingSSE2, powerSpectrumSSE2, dotSSE2, axpySSE2,
+                                             dotRowsWith<float, dotSSE2> };
+    if (cpuHasAVX2())
+        return avx2;
+    if (cpuHasSSE2())
+        return sse2;
+#endif
+#ifdef SIMD_NEON
+    static const mfccKernels<float> neon = { "NEON", preEmphHammingNEON, powerSpectrumNEON, dotNEON, axpyNEON,
+                                             dotRowsWith<float, dotNEON> };
+    if (cpuHasNEON())
+        return neon;
+#endif
+    return mfccKernelsScalar<float>();
+}
+
+// Reported once per precision, when the kernels are first asked for
+template <typename T>
+static const mfccKernels<T>& reportKernels(const mfccKernels<T> &kernels) {
+    qDebug() << "MFCC kernels:" << kernels.name << (sizeof(T) == sizeof(float) ? "float" : "double");
+    return kernels;
+}
+
+template <typename T>
+const mfccKernels<T>& mfccKernelsDetected() {
+    static const mfccKernels<T>& kernels = reportKernels(detectKernels((const T*) 0));
+    return kernels;
+}
+
+template const mfccKernels<float>& mfccKernelsScalar<float>();
+template const mfccKernels<double>& mfccKernelsScalar<double>();
+template const mfccKernels<float>& mfccKernelsDetected<float>();
+template const mfccKernels<double>& mfccKernelsDetected<double>();
@@ -0,0 +1,40 @@
+#ifndef SIMDKERNELS
+#define SIMDKERNELS
+
+#include <cstddef>
+
+/**
+ * Vectorised kernels of the MFCC hot loops. Every instruction set provides the same table of functions,
+ * the table matching the CPU is chosen once at startup and the scalar one stays available as reference.
+ * Tables exist for float and double samples.
+ *
+ * Elementwise kernels (preEmphHamming, powerSpectrum, axpy) evaluate exactly the scalar expressions and give
+ * bit-identical results on every instruction set. dot and dotRows sum in several lanes and may differ in the last bits.
+ */
+template <typename T>
+struct mfccKernels {
+    const char* name;
+
+    // out[0] = window[0]*in[0], out[i] = window[i] * (in[i] - coef*in[i-1]), in and out must not overlap
+    void (*preEmphHamming)(const T* in, const T* window, T coef, T* out, size_t n);
+    // power[i] = re*re + im*im of n complex values stored as interleaved (re, im) pairs
+    void (*powerSpectrum)(const T* spectrum, T* power, size_t n);
+    // Sum of a[i]*b[i]
+    T (*dot)(const T* a, const T* b, size_t n);
+    // acc[i] += w*x[i]
+    void (*axpy)(T w, const T* x, T* acc, size_t n);
+    // out[c] = sum of a[i]*rows[c*stride + i] for the numRows rows. A row is summed in the same order however many
+    // rows are passed, but not necessarily in the order of dot: the double kernels keep one accumulator per row where
+    // dot keeps two, so out[c] and dot(a, row c, n) may differ in the last bits.
+    void (*dotRows)(const T* a, const T* rows, size_t stride, size_t n, size_t numRows, T* out);
+};
+
+// Plain C++ loops, the reference every other kernel set is checked against
+template <typename T>
+const mfccKernels<T>& mfccKernelsScalar();
+// Best kernel set supported by the running CPU (AVX2, SSE2, NEON or scalar). NEON has double lanes only on AArch64,
+// on 32-bit ARM the float set is NEON and the double set the scalar one.
+template <typename T>
+const mfccKernels<T>& mfccKernelsDetected();
+
+#endif // SIMDKERNELS
@@ -0,0 +1,6 @@
+# The NEON kernels of simdkernels.cpp are only compiled when the compiler targets NEON. 32-bit ARM toolchains do not
+# enable it by default, the Cortex-A9 of the Apalis iMX6 has it.
+contains(QT_ARCH, arm) {
+    QMAKE_CFLAGS += -mfpu=neon
+    QMAKE_CXXFLAGS += -mfpu=neon
+}
@@ -0,0 +1,244 @@
+#include "similarityfile.h"
+
+#include <cstring>
+#include <limits>
+#include <math.h>
+#include <vector>
+
+#include <QAtomicInt>
+#include <QDebug>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+const size_t SimilarityFile::defaultTileSize;
+const quint64 SimilarityFile::maxMapBytes;
+
+struct SimilarityFileHeader
+{
+    char        magic[4];           // "SSMT"
+    quint32     version;            // 1
+    quint32     byteOrder;          // 0x01020304 in the byte order of the writer, the values are stored in it too
+    quint32     tileSize;           // Frames per tile side
+    quint64     numFrames;
+    quint64     tilesOffset;        // Byte offset of tile 0, page aligned
+};
+
+static const quint32 similarityFileVersion = 1;
+static const quint32 similarityFileByteOrder = 0x01020304;
+static const quint64 similarityFileTilesOffset = 4096;
+
+SimilarityFile::SimilarityFile(QObject *parent)
+    : QFile(parent)
+    , m_map(0)
+    , m_numFrames(0)
+    , m_tileSize(defaultTileSize)
+    , m_tilesOffset(0)
+{
+
+}
+
+SimilarityFile::~SimilarityFile()
+{
+    close();
+}
+
+bool SimilarityFile::open(const QString &fileName)
+{
+    close();
+    setFileName(fileName);
+    if (!QFile::open(QIODevice::ReadOnly) || !readHeader())
+        return false;
+
+    // An empty matrix has no tiles to map
+    if (m_numFrames == 0)
+        return true;
+    m_map = map(0, QFile::size());
+    return m_map != 0;
+}
+
+void SimilarityFile::close()
+{
+    if (m_map)
+        unmap(m_map);
+    m_map = 0;
+    m_numFrames = 0;
+    QFile::close();
+}
+
+bool SimilarityFile::readHeader()
+{
+    seek(0);
+    SimilarityFileHeader header;
+    if (read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header))
+        return false;
+    if (memcmp(header.magic, "SSMT", 4) != 0 || header.version != similarityFileVersion) {
+        qDebug() << "Not a self-similarity file:" << fileName();
+        return false;
+    }
+    if (header.byteOrder != similarityFileByteOrder || header.tileSize == 0) {
+        qDebug() << "Self-similarity file written with another byte order:" << fileName();
+        return false;
+    }
+
+    // A file without frames ends after the header
+    size_t tiles = (header.numFrames + header.tileSize - 1) / header.tileSize;
+    quint64 length = header.tilesOffset + (quint64) tileIndex(tiles, 0) * header.tileSize * header.tileSize * sizeof(float);
+    if (header.numFrames > 0 && (quint64) QFile::size() < length) {
+        qDebug() << "Self-similarity file is truncated:" << fileName();
+        return false;
+    }
+    if (length > maxMapBytes) {
+        qDebug() << "Self-similarity file is too large to map:" << fileName();
+        return false;
+    }
+
+    m_numFrames = header.numFrames;
+    m_tileSize = header.tileSize;
+    m_tilesOffset = header.tilesOffset;
+    return true;
+}
+
+size_t SimilarityFile::maxFrames(size_t tileSize)
+{
+    // Largest number of tile rows t with t*(t+1)/2 tiles in maxMapBytes, from the root and corrected for its rounding
+    quint64 tiles = (maxMapBytes - similarityFileTilesOffset) / (tileSize * tileSize * sizeof(float));
+    quint64 t = (quint64) ((sqrt(8.0 * tiles + 1) - 1) / 2);
+    while (t > 0 && t * (t + 1) / 2 > tiles)
+        t--;
+    while ((t + 1) * (t + 2) / 2 <= tiles)
+        t++;
+    return std::min(t * tileSize, (quint64) std::numeric_limits<size_t>::max());
+}
+
+// ***** Writer *****
+
+/* A batch of consecutive tiles of one tile row. Each tile is computed as its rows against the contiguous run of
+ * frames of its columns, one dotRows call per row. The T rows and T columns of a tile stay in L1 for T = 64.
+ * A tile on the diagonal is filled completely, dot(a, b) and dot(b, a) round the same products in the same order.
+ */
+class SimilarityFileTask : public QRunnable
+{
+public:
+    SimilarityFileTask(const FeatureMatrix &features, const mfccKernels<double> &kernels, size_t tileSize, size_t tileRow,
+                       size_t firstTile, size_t numTiles, std::vector<float> &batch, QAtomicInt &nextTile, QSemaphore &done)
+        : features(features), kernels(kernels), tileSize(tileSize), tileRow(tileRow), firstTile(firstTile),
+          numTiles(numTiles), batch(batch), nextTile(nextTile), done(done) {}
+
+    void run() {
+        std::vector<double> dots(tileSize);
+        for (;;) {
+            size_t k = (size_t) nextTile.fetchAndAddRelaxed(1);
+            if (k >= numTiles)
+                break;
+
+            size_t n = features.rows();
+            size_t r0 = tileRow * tileSize;
+            size_t c0 = (firstTile + k) * tileSize;
+            size_t rows = std::min(tileSize, n - r0);
+            size_t cols = std::min(tileSize, n - c0);
+
+            float* dst = &batch[k * tileSize * tileSize];
+            std::fill(dst, dst + tileSize * tileSize, 0.0f);
+            for (size_t r=0; r<rows; r++) {
+                kernels.dotRows(features.row(r0 + r), features.row(c0), features.stride(), features.stride(), cols, dots.data());
+                for (size_t c=0; c<cols; c++)
+                    dst[r * tileSize + c] = float(1 - dots[c]);
+            }
+        }
+        done.release();
+    }
+
+private:
+    const FeatureMatrix&        features;
+    const mfccKernels<double>&  kernels;
+    size_t                      tileSize;
+    size_t                      tileRow;
+    size_t                      firstTile;
+    size_t                      numTiles;
+    std::vector<float>&         batch;
+    QAtomicInt&                 nextTile;
+    QSemaphore&                 done;
+};
+
+// Write the tile rows from firstTileRow on and then the header with the new number of frames
+static bool writeTileRows(QFile &file, const FeatureMatrix &features, const mfccKernels<double> &kernels,
+                          size_t tileSize, size_t firstTileRow) {
+    // 32 tiles of 64 x 64 floats, 512 KB, are buffered between computing and writing
+    const size_t batchTiles = 32;
+    std::vector<float> batch(batchTiles * tileSize * tileSize);
+    size_t numTileRows = (features.rows() + tileSize - 1) / tileSize;
+    size_t maxWorkers = std::max(QThreadPool::globalInstance()->maxThreadCount(), 1);
+
+    for (size_t tr=firstTileRow; tr<numTileRows; tr++) {
+        if (!file.seek(similarityFileTilesOffset + (quint64) SimilarityFile::tileIndex(tr, 0) * tileSize * tileSize * sizeof(float)))
+            return false;
+
+        for (size_t tc=0; tc<=tr; tc+=batchTiles) {
+            size_t count = std::min(batchTiles, tr + 1 - tc);
+            size_t numWorkers = std::min(maxWorkers, count);
+
+            QAtomicInt nextTile(0);
+            QSemaphore done;
+            if (numWorkers <= 1) {
+                SimilarityFileTask(features, kernels, tileSize, tr, tc, count, batch, nextTile, done).run();
+            } else {
+                for (size_t w=0; w<numWorkers; w++)
+                    QThreadPool::globalInstance()->start(new SimilarityFileTask(features, kernels, tileSize, tr, tc, count,
+                                                                                batch, nextTile, done));
+                done.acquire(numWorkers);
+            }
+
+            qint64 bytes = count * tileSize * tileSize * sizeof(float);
+            if (file.write(reinterpret_cast<const char *>(batch.data()), bytes) != bytes)
+                return false;
+        }
+    }
+
+    SimilarityFileHeader header;
+    memcpy(header.magic, "SSMT", 4);
+    header.version = similarityFileVersion;
+    header.byteOrder = similarityFileByteOrder;
+    header.tileSize = tileSize;
+    header.numFrames = features.rows();
+    header.tilesOffset = similarityFileTilesOffset;
+    return file.seek(0) && file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == sizeof(header);
+}
+
+bool writeSimilarityFile(const QString &fileName, const FeatureMatrix &features, const mfccKernels<double> &kernels,
+                         size_t tileSize) {
+    if (features.rows() > SimilarityFile::maxFrames(tileSize)) {
+        qDebug() << "Self-similarity file of" << features.rows() << "frames is too large to map:" << fileName;
+        return false;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Unable to write self-similarity file:" << fileName;
+        return false;
+    }
+    return writeTileRows(file, features, kernels, tileSize, 0);
+}
+
+bool extendSimilarityFile(const QString &fileName, const FeatureMatrix &features, const mfccKernels<double> &kernels) {
+    size_t numFrames, tileSize;
+    {
+        SimilarityFile current;
+        if (!current.open(fileName))
+            return false;
+        numFrames = current.numFrames();
+        tileSize = current.tileSize();
+    }
+    if (numFrames > features.rows())
+        return false;
+    if (features.rows() > SimilarityFile::maxFrames(tileSize)) {
+        qDebug() << "Self-similarity file of" << features.rows() << "frames is too large to map:" << fileName;
+        return false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qDebug() << "Unable to write self-similarity file:" << fileName;
+        return false;
+    }
+    return writeTileRows(file, features, kernels, tileSize, numFrames / tileSize);
+}
@@ -0,0 +1,79 @@
+#ifndef SIMILARITYFILE
+#define SIMILARITYFILE
+
+#include <QFile>
+
+#include <algorithm>
+
+#include "similaritymatrix.h"
+
+/**
+ * Self-similarity matrix on disk, for recordings whose matrix does not fit into memory. The file holds a header and
+ * the tiles of the lower triangle, tile (tr, tc) with tr >= tc covering the rows [tr*T, tr*T + T) and the columns
+ * [tc*T, tc*T + T) as a full T x T square of floats, row-major. The tiles are stored tile row by tile row at
+ * tilesOffset + (tr*(tr+1)/2 + tc) * T*T*4, which does not depend on the number of frames, so frames can be appended
+ * without moving a tile. Values past the last frame are zero.
+ *
+ * The reader maps the whole file, only the pages of the tiles that are touched are read from disk. The length of a file
+ * is therefore limited to maxMapBytes, 1 GB with a 32-bit address space, which is maxFrames() = 23104 frames of 64 x 64
+ * tiles. Longer files are neither written nor opened.
+ */
+class SimilarityFile : public QFile
+{
+public:
+    static const size_t defaultTileSize = 64;
+    static const quint64 maxMapBytes = sizeof(void*) > 4 ? Q_UINT64_C(1) << 48 : Q_UINT64_C(1) << 30;
+
+    SimilarityFile(QObject *parent = 0);
+    ~SimilarityFile();
+
+    using QFile::open;
+    bool open(const QString &fileName);
+    void close();
+
+    size_t numFrames() const { return m_numFrames; }
+    size_t tileSize() const { return m_tileSize; }
+    size_t numTiles() const { return (m_numFrames + m_tileSize - 1) / m_tileSize; }
+
+    // Tile (tr, tc) of the lower triangle, tr >= tc
+    const float* tile(size_t tr, size_t tc) const {
+        return reinterpret_cast<const float*>(m_map + m_tilesOffset + tileIndex(tr, tc) * m_tileSize * m_tileSize * sizeof(float));
+    }
+
+    // Measure of frames i and j, in either order
+    float operator()(size_t i, size_t j) const {
+        if (i < j)
+            std::swap(i, j);
+        return tile(i / m_tileSize, j / m_tileSize)[(i % m_tileSize) * m_tileSize + j % m_tileSize];
+    }
+
+    static size_t tileIndex(size_t tr, size_t tc) { return tr*(tr+1)/2 + tc; }
+
+    // Most frames a file of at most maxMapBytes holds
+    static size_t maxFrames(size_t tileSize = defaultTileSize);
+
+private:
+    bool readHeader();
+
+    uchar*  m_map;
+    size_t  m_numFrames;
+    size_t  m_tileSize;
+    qint64  m_tilesOffset;
+};
+
+/* Write the self-similarity matrix of all frames to a new file, tile row by tile row
+ * Only a batch of tiles is held in memory at a time, the tiles of a batch are computed on the global thread pool.
+ * False without writing anything when features has more than SimilarityFile::maxFrames(tileSize) frames.
+ */
+bool writeSimilarityFile(const QString &fileName, const FeatureMatrix &features,
+                         const mfccKernels<double> &kernels = mfccKernelsDetected<double>(),
+                         size_t tileSize = SimilarityFile::defaultTileSize);
+
+/* Append the frames of features that the file does not hold yet
+ * The frames in the file must be the first ones of features. Only the last, partly filled tile row is written again,
+ * the tiles before it are not touched. False without writing anything past SimilarityFile::maxFrames() frames.
+ */
+bool extendSimilarityFile(const QString &fileName, const FeatureMatrix &features,
+                          const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+#endif // SIMILARITYFILE
@@ -0,0 +1,393 @@
+#include "similaritymatrix.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <math.h>
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+const size_t FeatureMatrix::featureAlign;
+
+/* Normalisation
+ * Every frame is scaled by the inverse of its L2 norm once, instead of recomputing both norms for every pair.
+ * An all-zero frame has no direction, its row becomes NaN just like the cosine it replaces.
+ */
+void FeatureMatrix::assign(const std::vector<std::vector<double>> &features) {
+    numRows = features.size();
+    numDims = numRows > 0 ? features[0].size() : 0;
+    rowStride = (numDims + featureAlign - 1) / featureAlign * featureAlign;
+    data.assign(numRows * rowStride, 0);
+
+    for (size_t i=0; i<numRows; i++)
+        normaliseRow(features[i].data(), numDims, &data[i * rowStride]);
+}
+
+void FeatureMatrix::append(const double* f, size_t dims) {
+    if (numRows == 0) {
+        numDims = dims;
+        rowStride = (numDims + featureAlign - 1) / featureAlign * featureAlign;
+    }
+    data.resize((numRows + 1) * rowStride, 0);
+    normaliseRow(f, numDims, &data[numRows * rowStride]);
+    numRows++;
+}
+
+void FeatureMatrix::normaliseRow(const double* f, size_t dims, double* out) {
+    double norm = 0;
+    for (size_t k=0; k<dims; k++)
+        norm += f[k] * f[k];
+    double scale = 1 / sqrt(norm);
+
+    for (size_t k=0; k<dims; k++)
+        out[k] = f[k] * scale;
+}
+
+template <typename T>
+void PackedSimilarityMatrix<T>::resize(size_t n) {
+    this->n = n;
+    data.resize(rowOffset(n), 0);
+}
+
+// Rows [r0, r1) against columns [c0, c1) of the stored triangle, the part right of the diagonal is skipped
+struct SimilarityTile {
+    size_t r0, r1, c0, c1;
+};
+
+/* Cache blocking
+ * The matrix of dot products is a product of the feature matrix with its own transpose. It is walked in tiles of
+ * similarityTileCols columns, which stay in L1 while the rows of every tile on or below the diagonal are streamed
+ * against them. Each row of a tile is one dotRows call over a contiguous run of columns, whose measures are written
+ * to the contiguous stored row. A measure only depends on its two rows, never on the tiling or on the thread
+ * computing it. Only rows from first on are tiled, which is what an online update appends.
+ */
+static std::vector<SimilarityTile> similarityTiles(size_t first, size_t n) {
+    std::vector<SimilarityTile> tiles;
+    for (size_t c0=0; c0<n; c0+=similarityTileCols) {
+        size_t c1 = std::min(c0 + similarityTileCols, n);
+        for (size_t r0=std::max(c0, first)/similarityTileRows*similarityTileRows; r0<n; r0+=similarityTileRows) {
+            SimilarityTile tile = { std::max(r0, first), std::min(r0 + similarityTileRows, n), c0, c1 };
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+template <typename T>
+static void computeTile(const FeatureMatrix &features, const SimilarityTile &tile, PackedSimilarityMatrix<T> &matrix,
+                        const mfccKernels<double> &kernels) {
+    double dots[similarityTileCols];
+    for (size_t r=std::max(tile.r0, tile.c0); r<tile.r1; r++) {
+        size_t count = std::min(tile.c1, r + 1) - tile.c0;
+        kernels.dotRows(features.row(r), features.row(tile.c0), features.stride(), features.stride(), count, dots);
+        T* dst = matrix.row(r) + tile.c0;
+        for (size_t k=0; k<count; k++)
+            dst[k] = T(1 - dots[k]);
+    }
+}
+
+template <typename T>
+void computeSimilarityMatrix(const FeatureMatrix &features, PackedSimilarityMatrix<T> &matrix,
+                             const mfccKernels<double> &kernels) {
+    matrix.resize(0);
+    extendSimilarityMatrix(features, matrix, kernels);
+}
+
+template <typename T>
+void extendSimilarityMatrix(const FeatureMatrix &features, PackedSimilarityMatrix<T> &matrix,
+                            const mfccKernels<double> &kernels) {
+    std::vector<SimilarityTile> tiles = similarityTiles(matrix.size(), features.rows());
+    matrix.resize(features.rows());
+    for (size_t t=0; t<tiles.size(); t++)
+        computeTile(features, tiles[t], matrix, kernels);
+}
+
+/* Work stealing
+ * The tiles are dealt round-robin to one queue per worker. A worker takes tiles from the front of its own queue and,
+ * once that is empty, steals from the back of the others until no tile is left anywhere. The tiles along the diagonal
+ * are partly empty and rows differ in length, so a static split leaves cores idle, stealing evens the load out at
+ * the cost of one uncontended lock per tile of ~4000 measures.
+ */
+class SimilarityTileQueue
+{
+public:
+    void push(const SimilarityTile &tile) { tiles.push_back(tile); }
+
+    bool takeFront(SimilarityTile &tile) {
+        QMutexLocker locker(&mutex);
+        if (tiles.empty())
+            return false;
+        tile = tiles.front();
+        tiles.pop_front();
+        return true;
+    }
+
+    bool stealBack(SimilarityTile &tile) {
+        QMutexLocker locker(&mutex);
+        if (tiles.empty())
+            return false;
+        tile = tiles.back();
+        tiles.pop_back();
+        return true;
+    }
+
+private:
+    QMutex                      mutex;
+    std::deque<SimilarityTile>  tiles;
+};
+
+template <typename T>
+class SimilarityTask : public QRunnable
+{
+public:
+    SimilarityTask(const FeatureMatrix &features, PackedSimilarityMatrix<T> &matrix, const mfccKernels<double> &kernels,
+                   std::vector<std::unique_ptr<SimilarityTileQueue>> &queues, size_t self, QSemaphore &done)
+        : features(features), matrix(matrix), kernels(kernels), queues(queues), self(self), done(done) {}
+
+    void run() {
+        SimilarityTile tile;
+        while (queues[self]->takeFront(tile))
+            computeTile(features, tile, matrix, kernels);
+
+        // Nothing is ever added to a queue, one pass over the victims that finds them all empty ends the work
+        size_t n = queues.size();
+        for (size_t k=1; k<n; k++)
+            while (queues[(self + k) % n]->stealBack(tile))
+                computeTile(features, tile, matrix, kernels);
+
+        done.release();
+    }
+
+private:
+    const FeatureMatrix&                                features;
+    PackedSimilarityMatrix<T>&                          matrix;
+    const mfccKernels<double>&                          kernels;
+    std::vector<std::unique_ptr<SimilarityTileQueue>>&  queues;
+    size_t                                              self;
+    QSemaphore&                                         done;
+};
+
+template <typename T>
+void computeSimilarityMatrixParallel(const FeatureMatrix &features, PackedSimilarityMatrix<T> &matrix,
+                                     const mfccKernels<double> &kernels) {
+    matrix.resize(0);
+    extendSimilarityMatrixParallel(features, matrix, kernels);
+}
+
+template <typename T>
+void extendSimilarityMatrixParallel(const FeatureMatrix &features, PackedSimilarityMatrix<T> &matrix,
+                                    const mfccKernels<double> &kernels) {
+    std::vector<SimilarityTile> tiles = similarityTiles(matrix.size(), features.rows());
+    size_t numWorkers = std::min((size_t) std::max(QThreadPool::globalInstance()->maxThreadCount(), 1), tiles.size());
+    if (numWorkers <= 1) {
+        extendSimilarityMatrix(features, matrix, kernels);
+        return;
+    }
+
+    matrix.resize(features.rows());
+    std::vector<std::unique_ptr<SimilarityTileQueue>> queues;
+    for (size_t w=0; w<numWorkers; w++)
+        queues.emplace_back(new SimilarityTileQueue);
+    for (size_t t=0; t<tiles.size(); t++)
+        queues[t % numWorkers]->push(tiles[t]);
+
+    QSemaphore done;
+    for (size_t w=0; w<numWorkers; w++)
+        QThreadPool::globalInstance()->start(new SimilarityTask<T>(features, matrix, kernels, queues, w, done));
+    done.acquire(numWorkers);
+}
+
+template <typename T>
+void BandedSimilarityMatrix<T>::reset(size_t maxLag) {
+    n = 0;
+    numLags = maxLag + 1;
+    capacity = 0;
+    data.clear();
+}
+
+// Grow the storage of every lag to frames, the frames present are moved to the new layout
+template <typename T>
+void BandedSimilarityMatrix<T>::reserve(size_t frames) {
+    if (frames <= capacity)
+        return;
+    std::vector<T> grown(numLags * frames, 0);
+    for (size_t l=0; l<numLags; l++)
+        std::copy(data.begin() + l*capacity, data.begin() + l*capacity + n, grown.begin() + l*frames);
+    data.swap(grown);
+    capacity = frames;
+}
+
+// Capacity grows geometrically as in append and only the frames from the old size on are cleared, so the online
+// refreshes of a recording cost O(maxLag) per new frame instead of O(N * maxLag) per refresh
+template <typename T>
+void BandedSimilarityMatrix<T>::resize(size_t n) {
+    if (n > capacity)
+        reserve(std::max(n, std::max(2 * capacity, (size_t) 1024)));
+    if (n > this->n)
+        for (size_t l=0; l<numLags; l++)
+            std::fill(data.begin() + l*capacity + this->n, data.begin() + l*capacity + n, 0);
+    this->n = n;
+}
+
+// Capacity doubles, so appending N frames copies O(N * maxLag) values in total
+template <typename T>
+void BandedSimilarityMatrix<T>::append(const T* measures) {
+    if (n == capacity)
+        reserve(std::max(2 * capacity, (size_t) 1024));
+    n++;
+    setFrame(n - 1, measures);
+}
+
+template <typename T>
+void BandedSimilarityMatrix<T>::setFrame(size_t i, const T* measures) {
+    size_t count = std::min(i, numLags - 1) + 1;
+    for (size_t l=0; l<count; l++)
+        data[l*capacity + i] = measures[l];
+}
+
+template <typename T>
+void BandedSimilarityStream<T>::reset(BandedSimilarityMatrix<T> &matrix, size_t maxLag) {
+    matrix.reset(maxLag);
+    numDims = 0;
+}
+
+template <typename T>
+void BandedSimilarityStream<T>::push(const double* frame, size_t dims, BandedSimilarityMatrix<T> &matrix,
+                                     const mfccKernels<double> &kernels) {
+    // The history is laid out once the size of the features is known
+    if (dims != numDims || matrix.maxLag() + 1 != numSlots) {
+        numDims = dims;
+        numSlots = matrix.maxLag() + 1;
+        rowStride = (dims + FeatureMatrix::featureAlign - 1) / FeatureMatrix::featureAlign * FeatureMatrix::featureAlign;
+        history.assign(2 * numSlots * rowStride, 0);
+        dots.resize(numSlots);
+        measures.resize(numSlots);
+    }
+
+    size_t i = matrix.size();
+    size_t slot = i % numSlots;
+    double* row = &history[slot * rowStride];
+    FeatureMatrix::normaliseRow(frame, dims, row);
+    std::copy(row, row + rowStride, &history[(slot + numSlots) * rowStride]);
+
+    // Frames i - count + 1 .. i, the oldest first
+    size_t count = std::min(i, numSlots - 1) + 1;
+    size_t first = (i - count + 1) % numSlots;
+    kernels.dotRows(row, &history[first * rowStride], rowStride, rowStride, count, dots.data());
+    for (size_t l=0; l<count; l++)
+        measures[l] = T(1 - dots[count - 1 - l]);
+    matrix.append(measures.data());
+}
+
+// Measures of frames [first, last) against the frames of their band, dots and measures hold maxLag + 1 values
+template <typename T>
+static void computeBandedFrames(const FeatureMatrix &features, size_t first, size_t last, BandedSimilarityMatrix<T> &matrix,
+                                const mfccKernels<double> &kernels, double* dots, T* measures) {
+    for (size_t i=first; i<last; i++) {
+        size_t count = std::min(i, matrix.maxLag()) + 1;
+        kernels.dotRows(features.row(i), features.row(i - count + 1), features.stride(), features.stride(), count, dots);
+        for (size_t l=0; l<count; l++)
+            measures[l] = T(1 - dots[count - 1 - l]);
+        matrix.setFrame(i, measures);
+    }
+}
+
+template <typename T>
+void computeBandedSimilarity(const FeatureMatrix &features, size_t maxLag, BandedSimilarityMatrix<T> &matrix,
+                             const mfccKernels<double> &kernels) {
+    matrix.reset(maxLag);
+    matrix.resize(features.rows());
+
+    std::vector<double> dots(maxLag + 1);
+    std::vector<T> measures(maxLag + 1);
+    computeBandedFrames(features, 0, features.rows(), matrix, kernels, dots.data(), measures.data());
+}
+
+/* Every frame of the band only writes its own column of each lag, so chunks of frames are independent. The workers
+ * pull chunks from a shared counter like the MFCC extraction does.
+ */
+template <typename T>
+class BandedSimilarityTask : public QRunnable
+{
+public:
+    static const size_t chunkFrames = 256;
+
+    BandedSimilarityTask(const FeatureMatrix &features, size_t firstFrame, BandedSimilarityMatrix<T> &matrix,
+                         const mfccKernels<double> &kernels, QAtomicInt &nextChunk, QSemaphore &done)
+        : features(features), firstFrame(firstFrame), matrix(matrix), kernels(kernels), nextChunk(nextChunk), done(done) {}
+
+    void run() {
+        std::vector<double> dots(matrix.maxLag() + 1);
+        std::vector<T> measures(matrix.maxLag() + 1);
+        for (;;) {
+            size_t first = firstFrame + (size_t) nextChunk.fetchAndAddRelaxed(1) * chunkFrames;
+            if (first >= features.rows())
+                break;
+            size_t last = std::min(first + chunkFrames, features.rows());
+            computeBandedFrames(features, first, last, matrix, kernels, dots.data(), measures.data());
+        }
+        done.release();
+    }
+
+private:
+    const FeatureMatrix&            features;
+    size_t                          firstFrame;
+    BandedSimilarityMatrix<T>&      matrix;
+    const mfccKernels<double>&      kernels;
+    QAtomicInt&                     nextChunk;
+    QSemaphore&                     done;
+};
+
+template <typename T>
+void computeBandedSimilarityParallel(const FeatureMatrix &features, size_t maxLag, BandedSimilarityMatrix<T> &matrix,
+                                     const mfccKernels<double> &kernels) {
+    matrix.reset(maxLag);
+    extendBandedSimilarityParallel(features, matrix, kernels);
+}
+
+template <typename T>
+void extendBandedSimilarityParallel(const FeatureMatrix &features, BandedSimilarityMatrix<T> &matrix,
+                                    const mfccKernels<double> &kernels) {
+    const size_t chunkFrames = BandedSimilarityTask<T>::chunkFrames;
+    size_t first = std::min(matrix.size(), features.rows());
+    size_t numChunks = (features.rows() - first + chunkFrames - 1) / chunkFrames;
+    size_t numWorkers = std::min((size_t) std::max(QThreadPool::globalInstance()->maxThreadCount(), 1), numChunks);
+    matrix.resize(features.rows());
+    if (numWorkers <= 1) {
+        std::vector<double> dots(matrix.maxLag() + 1);
+        std::vector<T> measures(matrix.maxLag() + 1);
+        computeBandedFrames(features, first, features.rows(), matrix, kernels, dots.data(), measures.data());
+        return;
+    }
+
+    QAtomicInt nextChunk(0);
+    QSemaphore done;
+    for (size_t w=0; w<numWorkers; w++)
+        QThreadPool::globalInstance()->start(new BandedSimilarityTask<T>(features, first, matrix, kernels, nextChunk, done));
+    done.acquire(numWorkers);
+}
+
+template class PackedSimilarityMatrix<float>;
+template class PackedSimilarityMatrix<double>;
+template void computeSimilarityMatrix(const FeatureMatrix &, PackedSimilarityMatrix<float> &, const mfccKernels<double> &);
+template void computeSimilarityMatrix(const FeatureMatrix &, PackedSimilarityMatrix<double> &, const mfccKernels<double> &);
+template void computeSimilarityMatrixParallel(const FeatureMatrix &, PackedSimilarityMatrix<float> &, const mfccKernels<double> &);
+template void computeSimilarityMatrixParallel(const FeatureMatrix &, PackedSimilarityMatrix<double> &, const mfccKernels<double> &);
+template class BandedSimilarityMatrix<float>;
+template class BandedSimilarityMatrix<double>;
+template class BandedSimilarityStream<float>;
+template class BandedSimilarityStream<double>;
+template void computeBandedSimilarity(const FeatureMatrix &, size_t, BandedSimilarityMatrix<float> &, const mfccKernels<double> &);
+template void computeBandedSimilarity(const FeatureMatrix &, size_t, BandedSimilarityMatrix<double> &, const mfccKernels<double> &);
+template void computeBandedSimilarityParallel(const FeatureMatrix &, size_t, BandedSimilarityMatrix<float> &, const mfccKernels<double> &);
+template void computeBandedSimilarityParallel(const FeatureMatrix &, size_t, BandedSimilarityMatrix<double> &, const mfccKernels<double> &);
+template void extendSimilarityMatrix(const FeatureMatrix &, PackedSimilarityMatrix<float> &, const mfccKernels<double> &);
+template void extendSimilarityMatrix(const FeatureMatrix &, PackedSimilarityMatrix<double> &, const mfccKernels<double> &);
+template void extendSimilarityMatrixParallel(const FeatureMatrix &, PackedSimilarityMatrix<float> &, const mfccKernels<double> &);
+template void extendSimilarityMatrixParallel(const FeatureMatrix &, PackedSimilarityMatrix<double> &, const mfccKernels<double> &);
+template void extendBandedSimilarityParallel(const FeatureMatrix &, BandedSimilarityMatrix<float> &, const mfccKernels<double> &);
+template void extendBandedSimilarityParallel(const FeatureMatrix &, BandedSimilarityMatrix<double> &, const mfccKernels<double> &);
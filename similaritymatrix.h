@@ -0,0 +1,202 @@
+#ifndef SIMILARITYMATRIX
+#define SIMILARITYMATRIX
+
+#include <cstddef>
+#include <vector>
+
+#include "simdkernels.h"
+
+/**
+ * Feature vectors of all frames, L2-normalised once and stored as one contiguous row-major matrix. The cosine
+ * similarity of two frames is then the dot product of their rows. Rows are zero-padded to a multiple of
+ * featureAlign values so that vector loops over a row need no remainder.
+ */
+class FeatureMatrix
+{
+public:
+    static const size_t featureAlign = 16;
+
+    FeatureMatrix() : numRows(0), numDims(0), rowStride(0) {}
+
+    // Normalise and store the given frames, replacing the current contents
+    void assign(const std::vector<std::vector<double>> &features);
+    // Normalise and append one frame, the first frame appended to an empty matrix sets dims()
+    void append(const double* f, size_t dims);
+    void clear() { numRows = 0; data.clear(); }
+    // Normalisation applied to every row, out may alias f
+    static void normaliseRow(const double* f, size_t dims, double* out);
+
+    size_t rows() const { return numRows; }
+    size_t dims() const { return numDims; }
+    size_t stride() const { return rowStride; }
+    const double* row(size_t i) const { return &data[i * rowStride]; }
+
+private:
+    size_t                  numRows;
+    size_t                  numDims;
+    size_t                  rowStride;
+    std::vector<double>     data;
+};
+
+/**
+ * Symmetric N x N similarity matrix storing only its lower triangle, diagonal included, in N*(N+1)/2 values.
+ * Stored row i holds the columns 0..i contiguously and starts at i*(i+1)/2, so (i, j) is found in O(1) and the
+ * matrix of N+1 frames is the one of N frames plus one more row at the end. float halves the memory of double,
+ * both are instantiated.
+ */
+template <typename T>
+class PackedSimilarityMatrix
+{
+public:
+    PackedSimilarityMatrix(size_t n = 0) : n(0) { resize(n); }
+
+    // Resize to n x n, the rows below n are kept and new measures are zero
+    void resize(size_t n);
+
+    size_t size() const { return n; }
+    size_t storedSize() const { return data.size(); }
+    static size_t rowOffset(size_t i) { return i*(i+1)/2; }
+
+    // Measure of frames i and j, in either order
+    T operator()(size_t i, size_t j) const { return i >= j ? data[rowOffset(i) + j] : data[rowOffset(j) + i]; }
+    T& at(size_t i, size_t j) { return i >= j ? data[rowOffset(i) + j] : data[rowOffset(j) + i]; }
+
+    // Stored part of row i, the columns 0..i
+    T* row(size_t i) { return &data[rowOffset(i)]; }
+    const T* row(size_t i) const { return &data[rowOffset(i)]; }
+
+    // Iterator over all n columns of a row, past the diagonal it follows the column down the stored triangle
+    class RowIterator
+    {
+    public:
+        RowIterator(const PackedSimilarityMatrix* m, size_t i, size_t j) : m(m), i(i), j(j) {}
+        T operator*() const { return (*m)(i, j); }
+        RowIterator& operator++() { j++; return *this; }
+        bool operator==(const RowIterator &other) const { return j == other.j; }
+        bool operator!=(const RowIterator &other) const { return j != other.j; }
+        size_t column() const { return j; }
+    private:
+        const PackedSimilarityMatrix*   m;
+        size_t                          i;
+        size_t                          j;
+    };
+
+    RowIterator rowBegin(size_t i) const { return RowIterator(this, i, 0); }
+    RowIterator rowEnd(size_t i) const { return RowIterator(this, i, n); }
+
+private:
+    size_t          n;
+    std::vector<T>  data;
+};
+
+// Tile of the similarity computation: 128 columns of 16 doubles are 16 KB, half of a 32 KB L1 data cache on the
+// Cortex-A9/A53 and on x86 cores, and the 32 rows streamed against them another 4 KB
+const size_t similarityTileRows = 32;
+const size_t similarityTileCols = 128;
+
+/* Self-similarity measures 1 - cos(a, b) of all pairs of frames
+ * matrix is resized to features.rows() and filled tile by tile, with kernels.dotRows as inner kernel. The dot
+ * products are computed in double and rounded to T once.
+ */
+template <typename T>
+void computeSimilarityMatrix(const FeatureMatrix &features, PackedSimilarityMatrix<T> &matrix,
+                             const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+// Same result as computeSimilarityMatrix, byte for byte, with the tiles spread over the global thread pool
+template <typename T>
+void computeSimilarityMatrixParallel(const FeatureMatrix &features, PackedSimilarityMatrix<T> &matrix,
+                                     const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+/* Online update: only the rows of the frames appended to features since matrix was computed, matrix.size() up to
+ * features.rows(), are computed against all frames and appended. The rows present are not touched, so every new frame
+ * costs O(N) and the result is the same, byte for byte, as computing the whole matrix again.
+ */
+template <typename T>
+void extendSimilarityMatrix(const FeatureMatrix &features, PackedSimilarityMatrix<T> &matrix,
+                            const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+template <typename T>
+void extendSimilarityMatrixParallel(const FeatureMatrix &features, PackedSimilarityMatrix<T> &matrix,
+                                    const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+/**
+ * Self-similarity restricted to the band |i - j| <= maxLag, for recordings whose full matrix does not fit. The
+ * measures are stored lag-major: lag l holds the measures of every frame i against frame i - l in one contiguous run,
+ * which is one line of the time-lag image. Memory is (maxLag+1) * N values and frames can be appended one at a time.
+ */
+template <typename T>
+class BandedSimilarityMatrix
+{
+public:
+    BandedSimilarityMatrix(size_t maxLag = 0) : n(0), numLags(maxLag + 1), capacity(0) {}
+
+    // Remove all frames and set the width of the band
+    void reset(size_t maxLag);
+    // Resize to n frames, new measures are zero
+    void resize(size_t n);
+    // Append frame size(), measures[l] is its measure against frame size() - l for l = 0 .. min(size(), maxLag())
+    void append(const T* measures);
+    // Set the measures of frame i, same layout as append
+    void setFrame(size_t i, const T* measures);
+
+    size_t size() const { return n; }
+    size_t maxLag() const { return numLags - 1; }
+    bool contains(size_t i, size_t j) const { return i < n && j < n && (i >= j ? i - j : j - i) < numLags; }
+
+    // Measure of frames i and j, in either order, contains(i, j) must hold
+    T operator()(size_t i, size_t j) const { return i >= j ? data[(i - j)*capacity + i] : data[(j - i)*capacity + j]; }
+
+    // Measures of lag l, element i is frame i against frame i - l, valid for l <= i < size()
+    const T* lag(size_t l) const { return data.data() + l*capacity; }
+
+private:
+    void reserve(size_t frames);
+
+    size_t          n;
+    size_t          numLags;
+    size_t          capacity;       // Frames per lag allocated
+    std::vector<T>  data;
+};
+
+/* Banded self-similarity computed frame by frame as the features arrive
+ * The normalised features of the frames in the band are kept in a history, every row written twice at slot k and
+ * k + maxLag + 1, so that the band of any frame is one contiguous run of rows for dotRows. Nothing is allocated per
+ * frame apart from the growth of the matrix. The measures are byte-identical to computeBandedSimilarity.
+ */
+template <typename T>
+class BandedSimilarityStream
+{
+public:
+    BandedSimilarityStream() : numDims(0), rowStride(0), numSlots(0) {}
+
+    // Start over, matrix is emptied and set to maxLag, the next frame pushed becomes its frame 0
+    void reset(BandedSimilarityMatrix<T> &matrix, size_t maxLag);
+    // Append the measures of the next frame against itself and the maxLag frames before it to matrix
+    void push(const double* frame, size_t dims, BandedSimilarityMatrix<T> &matrix,
+              const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+private:
+    size_t                  numDims;
+    size_t                  rowStride;
+    size_t                  numSlots;
+    std::vector<double>     history;
+    std::vector<double>     dots;
+    std::vector<T>          measures;
+};
+
+// Banded self-similarity of all frames at once, matrix is reset to maxLag
+template <typename T>
+void computeBandedSimilarity(const FeatureMatrix &features, size_t maxLag, BandedSimilarityMatrix<T> &matrix,
+                             const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+// Same result as computeBandedSimilarity, byte for byte, with chunks of frames spread over the global thread pool
+template <typename T>
+void computeBandedSimilarityParallel(const FeatureMatrix &features, size_t maxLag, BandedSimilarityMatrix<T> &matrix,
+                                     const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+// Online update of the band, the frames matrix.size() up to features.rows() are appended with matrix.maxLag()
+template <typename T>
+void extendBandedSimilarityParallel(const FeatureMatrix &features, BandedSimilarityMatrix<T> &matrix,
+                                    const mfccKernels<double> &kernels = mfccKernelsDetected<double>());
+
+#endif // SIMILARITYMATRIX
@@ -0,0 +1,156 @@
+#include "similaritypyramid.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+const size_t SimilarityPyramid::maxFileLevelFrames;
+
+/* Pooling
+ * Output row I pools the source rows [I << shift, (I+1) << shift) against all their columns, which is the source read
+ * row by row. The measures of a row only depend on the source, so rows can be pooled in any order and on any thread.
+ * The diagonal block reaches past the stored triangle of its first rows, these measures are read the other way round.
+ * Minimum pooling skips NaN measures of all-zero frames, mean pooling passes them on.
+ */
+template <typename Source>
+static void poolRows(const Source &source, size_t n, size_t shift, SimilarityPooling pooling, size_t firstRow,
+                     size_t lastRow, PackedSimilarityMatrix<float> &level, std::vector<double> &acc) {
+    for (size_t I=firstRow; I<lastRow; I++) {
+        size_t r0 = I << shift;
+        size_t r1 = std::min((I + 1) << shift, n);
+        acc.assign(I + 1, pooling == MinPooling ? std::numeric_limits<double>::infinity() : 0.0);
+
+        for (size_t r=r0; r<r1; r++) {
+            for (size_t j=0; j<r1; j++) {
+                double v = source(r, j);
+                double &a = acc[j >> shift];
+                if (pooling == MinPooling)
+                    a = v < a ? v : a;
+                else
+                    a += v;
+            }
+        }
+
+        float* dst = level.row(I);
+        for (size_t J=0; J<=I; J++) {
+            size_t cols = std::min((J + 1) << shift, r1) - (J << shift);
+            dst[J] = pooling == MinPooling ? float(acc[J]) : float(acc[J] / ((r1 - r0) * cols));
+        }
+    }
+}
+
+template <typename Source>
+class PoolTask : public QRunnable
+{
+public:
+    static const size_t chunkRows = 16;
+
+    PoolTask(const Source &source, size_t n, size_t shift, SimilarityPooling pooling, size_t firstRow,
+             PackedSimilarityMatrix<float> &level, QAtomicInt &nextChunk, QSemaphore &done)
+        : source(source), n(n), shift(shift), pooling(pooling), firstRow(firstRow), level(level),
+          nextChunk(nextChunk), done(done) {}
+
+    void run() {
+        std::vector<double> acc;
+        for (;;) {
+            size_t first = firstRow + (size_t) nextChunk.fetchAndAddRelaxed(1) * chunkRows;
+            if (first >= level.size())
+                break;
+            poolRows(source, n, shift, pooling, first, std::min(first + chunkRows, level.size()), level, acc);
+        }
+        done.release();
+    }
+
+private:
+    const Source&                   source;
+    size_t                          n;
+    size_t                          shift;
+    SimilarityPooling               pooling;
+    size_t                          firstRow;
+    PackedSimilarityMatrix<float>&  level;
+    QAtomicInt&                     nextChunk;
+    QSemaphore&                     done;
+};
+
+// Pool the rows from firstRow on of level, which is already resized, from the n frames of source
+template <typename Source>
+static void poolLevel(const Source &source, size_t n, size_t shift, SimilarityPooling pooling, size_t firstRow,
+                      PackedSimilarityMatrix<float> &level) {
+    const size_t chunkRows = PoolTask<Source>::chunkRows;
+    size_t numChunks = (level.size() - firstRow + chunkRows - 1) / chunkRows;
+    size_t numWorkers = std::min((size_t) std::max(QThreadPool::globalInstance()->maxThreadCount(), 1), numChunks);
+    if (numWorkers <= 1) {
+        std::vector<double> acc;
+        poolRows(source, n, shift, pooling, firstRow, level.size(), level, acc);
+        return;
+    }
+
+    QAtomicInt nextChunk(0);
+    QSemaphore done;
+    for (size_t w=0; w<numWorkers; w++)
+        QThreadPool::globalInstance()->start(new PoolTask<Source>(source, n, shift, pooling, firstRow, level, nextChunk, done));
+    done.acquire(numWorkers);
+}
+
+void SimilarityPyramid::update(const PackedSimilarityMatrix<float> &matrix) {
+    update(matrix, matrix.size(), 1);
+}
+
+void SimilarityPyramid::update(const SimilarityFile &file) {
+    size_t firstLevel = 1;
+    while (file.numFrames() > 0 && ((file.numFrames() - 1) >> firstLevel) + 1 > maxFileLevelFrames)
+        firstLevel++;
+    update(file, file.numFrames(), firstLevel);
+}
+
+void SimilarityPyramid::clear() {
+    numFrames = 0;
+    levels.clear();
+}
+
+/* Levels are built finest first. A row of a level is kept when none of its block of source rows changed since the
+ * last update, the rows from the first changed block on are pooled again. In the matrix only new rows appear, so a
+ * growing matrix costs O(N) per new frame on every level, like its own update.
+ */
+template <typename Source>
+void SimilarityPyramid::update(const Source &source, size_t n, size_t firstLevel) {
+    if (firstLevel != first || n < numFrames) {
+        clear();
+        first = firstLevel;
+    }
+
+    size_t sourceFrames = n;
+    size_t changedFrom = numFrames;     // First row of the source that changed
+    numFrames = n;
+
+    for (size_t k=0; sourceFrames > 1; k++) {
+        size_t shift = k == 0 ? first : 1;
+        size_t frames = ((sourceFrames - 1) >> shift) + 1;
+        if (k == levels.size())
+            levels.push_back(PackedSimilarityMatrix<float>());
+
+        PackedSimilarityMatrix<float> &level = levels[k];
+        size_t previousFrames = level.size();
+        size_t firstRow = std::min(changedFrom >> shift, previousFrames);
+        level.resize(frames);
+        if (k == 0)
+            poolLevel(source, sourceFrames, shift, pooling, firstRow, level);
+        else
+            poolLevel(levels[k - 1], sourceFrames, shift, pooling, firstRow, level);
+
+        changedFrom = firstRow;
+        sourceFrames = frames;
+    }
+}
+
+size_t SimilarityPyramid::levelFor(double framesPerPixel) const {
+    if (framesPerPixel < 2 || levels.empty())
+        return 0;
+    size_t k = (size_t) floor(log2(framesPerPixel));
+    return std::min(std::max(k, first), numLevels() - 1);
+}
@@ -0,0 +1,55 @@
+#ifndef SIMILARITYPYRAMID
+#define SIMILARITYPYRAMID
+
+#include <cstddef>
+#include <vector>
+
+#include "similarityfile.h"
+#include "similaritymatrix.h"
+
+enum SimilarityPooling { MeanPooling, MinPooling };
+
+/**
+ * Mip-map pyramid of a self-similarity matrix for zoomable display. Level k covers 2^k x 2^k frames per measure and
+ * has ceil(n / 2^k) frames, each measure pooling a 2 x 2 block of level k-1 by its mean or its minimum. Level 0 is the
+ * matrix itself and not stored, the levels go down to a single measure. A view showing f frames per pixel draws
+ * level floor(log2(f)), which has at most two measures per pixel whatever the length of the recording.
+ *
+ * The pyramid of a matrix in memory starts at level 1. A matrix in a SimilarityFile is pooled straight into the
+ * first level with at most maxFileLevelFrames frames, so the finer levels never have to fit into memory.
+ */
+class SimilarityPyramid
+{
+public:
+    static const size_t maxFileLevelFrames = 4096;
+
+    SimilarityPyramid() : numFrames(0), first(1), pooling(MeanPooling) {}
+
+    /* Bring the levels up to date with the matrix, rows of frames added since the last update are pooled on the
+     * global thread pool, the rows pooled before are kept. clear() first when the matrix is a different one.
+     */
+    void update(const PackedSimilarityMatrix<float> &matrix);
+    void update(const SimilarityFile &file);
+    void clear();
+
+    void setPooling(SimilarityPooling pooling) { clear(); this->pooling = pooling; }
+
+    size_t size() const { return numFrames; }
+    size_t firstLevel() const { return first; }
+    size_t numLevels() const { return first + levels.size(); }
+    const PackedSimilarityMatrix<float>& level(size_t k) const { return levels[k - first]; }
+
+    // Level to draw at framesPerPixel, 0 for the matrix itself, else a stored level
+    size_t levelFor(double framesPerPixel) const;
+
+private:
+    template <typename Source>
+    void update(const Source &source, size_t n, size_t firstLevel);
+
+    size_t                                      numFrames;
+    size_t                                      first;
+    SimilarityPooling                           pooling;
+    std::vector<PackedSimilarityMatrix<float>>  levels;
+};
+
+#endif // SIMILARITYPYRAMID
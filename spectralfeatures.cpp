@@ -0,0 +1,155 @@
+#include "spectralfeatures.h"
+
+#include <algorithm>
+#include <math.h>
+
+template <typename T>
+const size_t SpectralFeatures<T>::numChroma;
+
+// Share of the energy below the rolloff frequency
+const double rolloffShare = 0.85;
+
+// Range of the bins mapped to pitch classes, lower bins are wider than an octave
+const double chromaLowFreq = 100;
+const double chromaHighFreq = 5000;
+
+/* Weights
+ * The pre-emphasis y(t) = x(t) - a x(t-1) has the power gain |1 - a e^(-iw)|^2 at frequency w, every table weight is
+ * divided by it. The mean square of a frame of N samples is (P[0] + P[N/2] + 2 * sum of the other P[k]) / N^2 for the
+ * power spectrum P of its real DFT. The frame is windowed, dividing by N * windowEnergy rather than N^2 gives the mean
+ * square of the signal under the window.
+ */
+template <typename T>
+SpectralFeatures<T>::SpectralFeatures(unsigned features, size_t fs, size_t numFFT, double windowEnergy,
+                                      double preEmphCoef, const mfccKernels<T> &kernels)
+    : flags(features), numBins(numFFT / 2 + 1), kernels(&kernels), hasPrevious(false)
+{
+    const double pi = 4*atan(1.0);
+    std::vector<double> inverseGain(numBins);
+    for (size_t k=0; k<numBins; k++) {
+        double w = pi * k / (numBins - 1);
+        inverseGain[k] = 1 / (1 - 2*preEmphCoef*cos(w) + preEmphCoef*preEmphCoef);
+    }
+
+    gain.assign(numBins, 0);
+    binFrequency.assign(numBins, 0);
+    centroidWeights.assign(numBins, 0);
+    rmsWeights.assign(numBins, 0);
+    for (size_t k=0; k<numBins; k++) {
+        gain[k] = T(inverseGain[k]);
+        binFrequency[k] = T(double(k) / (numBins - 1));
+        centroidWeights[k] = T(inverseGain[k] * k / (numBins - 1));
+        rmsWeights[k] = T(inverseGain[k] * (k == 0 || 2*k == numFFT ? 1 : 2) / (numFFT * windowEnergy));
+    }
+    magnitude.assign(numBins, 0);
+    previousMagnitude.assign(numBins, 0);
+    cumulative.assign(numBins, 0);
+
+    if (flags & ChromaFeature)
+        initChroma(fs, numFFT, inverseGain);
+}
+
+template <typename T>
+size_t SpectralFeatures<T>::size() const {
+    return (flags & ChromaFeature ? numChroma : 0) + (flags & ShapeFeature ? 3 : 0) + (flags & RmsFeature ? 1 : 0);
+}
+
+/* Chroma mapping
+ * A bin of frequency f lies 12 * log2(f / 440) + 9 semitones above a C. Its energy is spread over the pitch classes
+ * by a Gaussian of their circular distance in semitones, as wide as the bin, so the coarse low bins feed several
+ * classes and the narrow high ones a single class. The weights of every bin sum to 1.
+ */
+template <typename T>
+void SpectralFeatures<T>::initChroma(size_t fs, size_t numFFT, const std::vector<double> &gain) {
+    double binWidth = double(fs) / numFFT;
+    std::vector<std::vector<double>> weights(numChroma, std::vector<double>(numBins, 0));
+    for (size_t k=1; k<numBins; k++) {
+        double f = k * binWidth;
+        if (f < chromaLowFreq || f > chromaHighFreq)
+            continue;
+        double semitone = 12 * log2(f / 440) + 9;
+        double sigma = std::max(0.5, 6 * log2((f + binWidth/2) / (f - binWidth/2)));
+        double total = 0;
+        for (size_t c=0; c<numChroma; c++) {
+            double d = fmod(semitone - c, 12.0);
+            d = d < -6 ? d + 12 : (d >= 6 ? d - 12 : d);
+            weights[c][k] = exp(-d*d / (2*sigma*sigma));
+            total += weights[c][k];
+        }
+        for (size_t c=0; c<numChroma; c++)
+            weights[c][k] /= total;
+    }
+
+    const double minWeight = 1e-3;
+    chroma.offset.assign(1, 0);
+    chroma.bins.clear();
+    chroma.weights.clear();
+    for (size_t c=0; c<numChroma; c++) {
+        for (size_t k=0; k<numBins; k++) {
+            if (weights[c][k] > minWeight) {
+                chroma.bins.push_back(k);
+                chroma.weights.push_back(T(weights[c][k] * gain[k]));
+            }
+        }
+        chroma.offset.push_back(chroma.bins.size());
+    }
+}
+
+template <typename T>
+void SpectralFeatures<T>::process(const T* power, T* out) {
+    if (flags & ChromaFeature) {
+        T total = 0;
+        for (size_t c=0; c<numChroma; c++) {
+            T sum = 0;
+            for (size_t k=chroma.offset[c]; k<chroma.offset[c+1]; k++)
+                sum += chroma.weights[k] * power[chroma.bins[k]];
+            out[c] = sum;
+            total += sum;
+        }
+        for (size_t c=0; c<numChroma; c++)
+            out[c] = total > 0 ? out[c] / total : T(0);
+        out += numChroma;
+    }
+
+    if (flags & ShapeFeature) {
+        // Centroid and rolloff as fractions of fs/2, 0 for a silent frame
+        T sum = 0;
+        for (size_t k=0; k<numBins; k++) {
+            magnitude[k] = gain[k] * power[k];
+            sum += magnitude[k];
+            cumulative[k] = sum;
+        }
+        T total = cumulative[numBins - 1];
+        T centroid = total > 0 ? kernels->dot(centroidWeights.data(), power, numBins) / total : T(0);
+        size_t rolloff = std::lower_bound(cumulative.begin(), cumulative.end(), T(rolloffShare) * total)
+                - cumulative.begin();
+        rolloff = std::min(rolloff, numBins - 1);
+
+        // Flux: norm of the rise of the magnitudes since the previous frame, relative to the norm of this frame
+        for (size_t k=0; k<numBins; k++)
+            magnitude[k] = sqrt(magnitude[k]);
+        T rise = 0;
+        if (hasPrevious) {
+            for (size_t k=0; k<numBins; k++) {
+                T d = magnitude[k] - previousMagnitude[k];
+                rise += d > 0 ? d * d : T(0);
+            }
+        }
+        magnitude.swap(previousMagnitude);
+        hasPrevious = true;
+
+        out[0] = centroid;
+        out[1] = total > 0 ? binFrequency[rolloff] : T(0);
+        out[2] = total > 0 ? sqrt(rise / total) : T(0);
+        out += 3;
+    }
+
+    if (flags & RmsFeature) {
+        // log of the RMS, floored at 1 like the Mel energies
+        T meanSquare = kernels->dot(rmsWeights.data(), power, numBins);
+        out[0] = T(0.5) * log(meanSquare < 1 ? T(1) : meanSquare);
+    }
+}
+
+template class SpectralFeatures<float>;
+template class SpectralFeatures<double>;
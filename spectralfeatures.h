@@ -0,0 +1,78 @@
+#ifndef SPECTRALFEATURES
+#define SPECTRALFEATURES
+
+#include <cstddef>
+#include <vector>
+
+#include "simdkernels.h"
+
+// Features derived from the power spectrum of a frame besides the MFCCs, combined as flags
+enum SpectralFeature {
+    ChromaFeature = 0x1,            // 12 pitch class energies, C first, summing to 1
+    ShapeFeature = 0x2,             // Spectral centroid, 85 % rolloff and flux
+    RmsFeature = 0x4                // Log RMS of the frame
+};
+
+/* Sparse bin map
+ * Output i sums weights[k] * power[bins[k]] for k in [offset[i], offset[i+1]), only the bins with a weight above
+ * minWeight are stored. The bins of an output need not be contiguous, a pitch class collects bins of every octave.
+ */
+template <typename T>
+struct sparseBinMap {
+    std::vector<size_t>     offset;     // numOutputs + 1 entries
+    std::vector<size_t>     bins;
+    std::vector<T>          weights;
+};
+
+/**
+ * Spectral feature sinks fed with the power spectrum MfccExtractor already computes for the MFCCs, so further
+ * features cost a few passes over its numFFT/2 + 1 bins instead of another FFT. The mapping of every feature is
+ * tabulated at construction and nothing is allocated per frame. That spectrum is pre-emphasised; the tables undo
+ * the gain of the pre-emphasis filter at every bin, so the features describe the signal itself.
+ *
+ * Frequencies are given as fractions of fs/2 and the flux relative to the magnitude of the frame, which keeps all
+ * features near the range of the MFCCs when frames are compared by cosine. The flux needs the spectrum of the
+ * previous frame; after reset() the next frame has a flux of 0.
+ */
+template <typename T>
+class SpectralFeatures
+{
+public:
+    // windowEnergy is the sum of the squared window weights, which the RMS corrects for
+    SpectralFeatures(unsigned features = 0, size_t fs = 44100, size_t numFFT = 512, double windowEnergy = 1,
+                     double preEmphCoef = 0, const mfccKernels<T> &kernels = mfccKernelsDetected<T>());
+
+    void setKernels(const mfccKernels<T> &kernels) { this->kernels = &kernels; }
+
+    unsigned features() const { return flags; }
+    // Number of values process() writes
+    size_t size() const;
+    bool needsPreviousFrame() const { return flags & ShapeFeature; }
+
+    // Forget the previous frame
+    void reset() { hasPrevious = false; }
+    // Write the features of the numFFT/2 + 1 bins of power to out, chroma first, then shape and RMS
+    void process(const T* power, T* out);
+
+    static const size_t numChroma = 12;
+
+private:
+    void initChroma(size_t fs, size_t numFFT, const std::vector<double> &gain);
+
+    unsigned                flags;
+    size_t                  numBins;
+    const mfccKernels<T>*   kernels;
+
+    sparseBinMap<T>         chroma;
+    std::vector<T>          gain;               // Inverse power gain of the pre-emphasis at every bin
+    std::vector<T>          binFrequency;       // Fraction of fs/2 of every bin
+    std::vector<T>          centroidWeights;    // binFrequency * gain
+    std::vector<T>          rmsWeights;         // Parseval weights of the bins, window energy and gain included
+
+    std::vector<T>          magnitude;          // Of the current frame and the previous one
+    std::vector<T>          previousMagnitude;
+    std::vector<T>          cumulative;         // Running sum of the gained power up to every bin
+    bool                    hasPrevious;
+};
+
+#endif // SPECTRALFEATURES
@@ -0,0 +1,39 @@
+#include <QtTest>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include "tests.h"
+
+std::vector<TestFactory>& registeredTests() {
+    static std::vector<TestFactory> tests;
+    return tests;
+}
+
+std::vector<int16_t> testSignal(size_t n, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> normal(0, 2000);
+    std::vector<int16_t> samples(n);
+    double state = 0;
+    for (size_t i=0; i<n; i++) {
+        state = 0.9 * state + normal(generator) * (1 + (i / 22050) % 4);
+        samples[i] = (int16_t) std::max(-32768.0, std::min(32767.0, state));
+    }
+    return samples;
+}
+
+// Run every registered test class, the exit code is the number of failed tests
+int main(int argc, char *argv[])
+{
+    // FFTW wisdom and any other application data go to the test locations, not to those of the application
+    QStandardPaths::setTestModeEnabled(true);
+
+    int failed = 0;
+    for (TestFactory create : registeredTests()) {
+        std::unique_ptr<QObject> test(create());
+        failed += QTest::qExec(test.get(), argc, argv);
+    }
+    return failed;
+}
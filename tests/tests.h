@@ -0,0 +1,26 @@
+#ifndef TESTS
+#define TESTS
+
+#include <QObject>
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/* The tests of all modules link into one executable. Every test file registers its test class with a static
+ * TestRegistration, and main() runs the registered classes in turn with QTest::qExec.
+ */
+typedef QObject* (*TestFactory)();
+std::vector<TestFactory>& registeredTests();
+
+template <typename Test>
+struct TestRegistration
+{
+    TestRegistration() { registeredTests().push_back(&create); }
+    static QObject* create() { return new Test(); }
+};
+
+// Coloured noise with a few seconds of level changes, so that every stage sees non-trivial input
+std::vector<int16_t> testSignal(size_t n, unsigned seed = 1);
+
+#endif // TESTS
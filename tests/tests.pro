@@ -0,0 +1,52 @@
+TEMPLATE = app
+TARGET = tests
+
+QT += testlib
+QT -= gui
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+HEADERS += tests.h \
+    ../decimator.h \
+    ../featurefile.h \
+    ../fftplan.h \
+    ../fixedpointmfcc.h \
+    ../mfccextractor.h \
+    ../noveltycurve.h \
+    ../repetitionindex.h \
+    ../self-similarity.h \
+    ../similarityfile.h \
+    ../similaritymatrix.h \
+    ../similaritypyramid.h \
+    ../simdkernels.h \
+    ../spectralfeatures.h
+
+SOURCES += main.cpp \
+    tst_decimator.cpp \
+    tst_featurefile.cpp \
+    tst_mfcc.cpp \
+    tst_noveltycurve.cpp \
+    tst_repetitionindex.cpp \
+    tst_selfsimilarity.cpp \
+    tst_similarity.cpp \
+    tst_similaritypyramid.cpp \
+    ../decimator.cpp \
+    ../featurefile.cpp \
+    ../fftplan.cpp \
+    ../fixedpointmfcc.cpp \
+    ../mfccextractor.cpp \
+    ../noveltycurve.cpp \
+    ../repetitionindex.cpp \
+    ../self-similarity.cpp \
+    ../similarityfile.cpp \
+    ../similaritymatrix.cpp \
+    ../similaritypyramid.cpp \
+    ../simdkernels.cpp \
+    ../spectralfeatures.cpp
+
+LIBS += $$PWD/../libfftw3.a
+
+include(../simdkernels.pri)
@@ -0,0 +1,140 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "decimator.h"
+#include "tests.h"
+
+static std::vector<int16_t> tone(double frequency, double amplitude, size_t fs, size_t n) {
+    const double pi = 4*atan(1.0);
+    std::vector<int16_t> samples(n);
+    for (size_t i=0; i<n; i++)
+        samples[i] = (int16_t) lrint(amplitude * sin(2*pi*frequency*i / fs));
+    return samples;
+}
+
+// Amplitude of the frequency component of the samples from first on, by projection onto sine and cosine over the
+// whole number of periods that fits
+static double amplitudeAt(const std::vector<int16_t> &samples, size_t first, double frequency, size_t fs) {
+    const double pi = 4*atan(1.0);
+    double periods = floor((samples.size() - first) * frequency / fs);
+    size_t n = (size_t) lrint(periods * fs / frequency);
+    double s = 0, c = 0;
+    for (size_t i=first; i<first+n; i++) {
+        s += samples[i] * sin(2*pi*frequency*i / fs);
+        c += samples[i] * cos(2*pi*frequency*i / fs);
+    }
+    return 2 * sqrt(s*s + c*c) / n;
+}
+
+static double rms(const std::vector<int16_t> &samples, size_t first) {
+    double sum = 0;
+    for (size_t i=first; i<samples.size(); i++)
+        sum += double(samples[i]) * samples[i];
+    return sqrt(sum / (samples.size() - first));
+}
+
+class TestDecimator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void passbandGain_data();
+    void passbandGain();
+    void stopbandAttenuation_data();
+    void stopbandAttenuation();
+    void chunkSizeInvariance();
+};
+
+void TestDecimator::passbandGain_data() {
+    QTest::addColumn<int>("inputRate");
+    QTest::addColumn<double>("frequency");
+
+    QTest::newRow("44.1 kHz, 100 Hz") << 44100 << 100.0;
+    QTest::newRow("44.1 kHz, 1 kHz") << 44100 << 1000.0;
+    QTest::newRow("44.1 kHz, 3.9 kHz") << 44100 << 3900.0;
+    QTest::newRow("48 kHz, 1 kHz") << 48000 << 1000.0;
+    QTest::newRow("48 kHz, 3.9 kHz") << 48000 << 3900.0;
+}
+
+// A tone below the 4 kHz passband edge leaves the 16 kHz output within 0.01 dB of its level
+void TestDecimator::passbandGain() {
+    QFETCH(int, inputRate);
+    QFETCH(double, frequency);
+    const double amplitude = 10000;
+
+    PolyphaseDecimator decimator(inputRate, 16000);
+    std::vector<int16_t> out;
+    std::vector<int16_t> in = tone(frequency, amplitude, inputRate, inputRate);
+    decimator.process(in.data(), in.size(), out);
+    QVERIFY(out.size() > 15000);
+
+    // Past the start-up of the filter
+    size_t first = (size_t) ceil(2 * decimator.delay());
+    double gain = 20 * log10(amplitudeAt(out, first, frequency, 16000) / amplitude);
+    QVERIFY2(std::abs(gain) < 0.01, qPrintable(QString("gain %1 dB").arg(gain)));
+}
+
+void TestDecimator::stopbandAttenuation_data() {
+    QTest::addColumn<int>("inputRate");
+    QTest::addColumn<double>("frequency");
+
+    QTest::newRow("44.1 kHz, 8 kHz") << 44100 << 8000.0;
+    QTest::newRow("44.1 kHz, 9 kHz") << 44100 << 9000.0;
+    QTest::newRow("44.1 kHz, 12 kHz") << 44100 << 12000.0;
+    QTest::newRow("44.1 kHz, 20 kHz") << 44100 << 20000.0;
+    QTest::newRow("48 kHz, 8.5 kHz") << 48000 << 8500.0;
+    QTest::newRow("48 kHz, 23 kHz") << 48000 << 23000.0;
+}
+
+/* A tone from the output Nyquist frequency up would alias into the output. The 80 dB design leaves at most the
+ * rounding noise of the int16 output, 75 dB below a full scale tone.
+ */
+void TestDecimator::stopbandAttenuation() {
+    QFETCH(int, inputRate);
+    QFETCH(double, frequency);
+
+    PolyphaseDecimator decimator(inputRate, 16000);
+    std::vector<int16_t> out;
+    std::vector<int16_t> in = tone(frequency, 30000, inputRate, inputRate);
+    decimator.process(in.data(), in.size(), out);
+
+    size_t first = (size_t) ceil(2 * decimator.delay());
+    double attenuation = 20 * log10(rms(in, 0) / std::max(rms(out, first), 1e-9));
+    QVERIFY2(attenuation > 75, qPrintable(QString("attenuation %1 dB").arg(attenuation)));
+}
+
+// The output does not depend on how the input is cut into chunks, nor on an earlier stream before reset()
+void TestDecimator::chunkSizeInvariance() {
+    std::vector<int16_t> in = testSignal(44100);
+    PolyphaseDecimator decimator(44100, 16000);
+    std::vector<int16_t> expected;
+    decimator.process(in.data(), in.size(), expected);
+
+    const size_t sizes[] = { 1, 7, 160, 441, 4096 };
+    for (size_t chunk : sizes) {
+        decimator.reset();
+        std::vector<int16_t> out;
+        for (size_t i=0; i<in.size(); i+=chunk)
+            decimator.process(in.data() + i, std::min(chunk, in.size() - i), out);
+        QVERIFY2(out == expected, qPrintable(QString("chunks of %1 samples").arg(chunk)));
+    }
+
+    std::mt19937 generator(3);
+    std::uniform_int_distribution<size_t> size(0, 1000);
+    decimator.reset();
+    std::vector<int16_t> out;
+    for (size_t i=0; i<in.size(); ) {
+        size_t chunk = std::min(size(generator), in.size() - i);
+        decimator.process(in.data() + i, chunk, out);
+        i += chunk;
+    }
+    QVERIFY(out == expected);
+}
+
+static TestRegistration<TestDecimator> registration;
+
+#include "tst_decimator.moc"
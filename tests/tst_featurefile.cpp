@@ -0,0 +1,175 @@
+#include <QtTest>
+#include <QtEndian>
+#include <QTemporaryDir>
+
+#include <cstring>
+#include <vector>
+
+#include "featurefile.h"
+#include "tests.h"
+
+static FeatureFileInfo testInfo(size_t deltaOrder, unsigned spectralFeatures = 0) {
+    FeatureFileInfo info;
+    info.config = { 16000, 12, 40, 512, 25, 10, 50, 6500 };
+    info.deltaOrder = deltaOrder;
+    info.spectralFeatures = spectralFeatures;
+    // C0, c1 .. c12 and the spectral features in every block
+    size_t block = info.config.numCepstral + 1;
+    if (spectralFeatures & ChromaFeature)
+        block += 12;
+    if (spectralFeatures & ShapeFeature)
+        block += 3;
+    if (spectralFeatures & RmsFeature)
+        block += 1;
+    info.dims = block * (deltaOrder + 1);
+    return info;
+}
+
+// Value d of frame i, exact in float32 and different for every value of the first frames
+static double testValue(size_t i, size_t d) {
+    return (i % 1000) * 64.0 + d + 0.25;
+}
+
+static bool writeFile(const QString &fileName, const FeatureFileInfo &info, FeatureFileFormat format, size_t frames) {
+    FeatureFileWriter writer;
+    if (!writer.open(fileName, info, format))
+        return false;
+    std::vector<double> frame(info.dims);
+    for (size_t i=0; i<frames; i++) {
+        for (size_t d=0; d<info.dims; d++)
+            frame[d] = testValue(i, d);
+        writer.write(frame.data());
+    }
+    return writer.size() == frames && writer.close();
+}
+
+static std::vector<uchar> readBytes(const QString &fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return std::vector<uchar>();
+    std::vector<uchar> bytes(file.size());
+    if (!bytes.empty() && file.read(reinterpret_cast<char *>(bytes.data()), bytes.size()) != qint64(bytes.size()))
+        bytes.clear();
+    return bytes;
+}
+
+class TestFeatureFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void nativeRoundTrip_data();
+    void nativeRoundTrip();
+    void htkLayout_data();
+    void htkLayout();
+
+private:
+    QTemporaryDir dir;
+};
+
+void TestFeatureFile::nativeRoundTrip_data() {
+    QTest::addColumn<int>("frames");
+    QTest::addColumn<int>("deltaOrder");
+    QTest::addColumn<unsigned>("spectralFeatures");
+
+    QTest::newRow("no frames") << 0 << 0 << 0u;
+    QTest::newRow("one frame") << 1 << 0 << 0u;
+    QTest::newRow("deltas and spectral features") << 500 << 1 << unsigned(ChromaFeature | RmsFeature);
+    QTest::newRow("several blocks") << 60000 << 2 << 0u;
+}
+
+/* The frames read back through the mapping must be the written ones converted to float32, with the configuration of
+ * the header. 60000 frames of 39 values take more than two blocks of the writer.
+ */
+void TestFeatureFile::nativeRoundTrip() {
+    QFETCH(int, frames);
+    QFETCH(int, deltaOrder);
+    QFETCH(unsigned, spectralFeatures);
+    QVERIFY(dir.isValid());
+    QString fileName = dir.filePath("native.mfcf");
+    FeatureFileInfo info = testInfo(deltaOrder, spectralFeatures);
+    QVERIFY(writeFile(fileName, info, NativeFeatureFile, frames));
+
+    FeatureFile file;
+    QVERIFY(file.open(fileName));
+    QCOMPARE(file.numFrames(), size_t(frames));
+    QCOMPARE(file.dims(), info.dims);
+    QVERIFY(file.info().config == info.config);
+    QCOMPARE(file.info().config.lowFreq, info.config.lowFreq);
+    QCOMPARE(file.info().config.highFreq, info.config.highFreq);
+    QCOMPARE(file.info().deltaOrder, info.deltaOrder);
+    QCOMPARE(file.info().spectralFeatures, info.spectralFeatures);
+
+    size_t mismatches = 0;
+    for (size_t i=0; i<file.numFrames(); i++) {
+        const float* frame = file.frame(i);
+        for (size_t d=0; d<info.dims; d++)
+            mismatches += frame[d] != float(testValue(i, d));
+    }
+    QCOMPARE(mismatches, size_t(0));
+    file.close();
+
+    // A file shorter than its frames is refused
+    if (frames > 0) {
+        QFile truncated(fileName);
+        QVERIFY(truncated.resize(truncated.size() - qint64(sizeof(float))));
+        QVERIFY(!file.open(fileName));
+    }
+}
+
+void TestFeatureFile::htkLayout_data() {
+    QTest::addColumn<int>("deltaOrder");
+    QTest::addColumn<unsigned>("spectralFeatures");
+    QTest::addColumn<unsigned>("parmKind");
+
+    QTest::newRow("MFCC_0") << 0 << 0u << 0x2006u;
+    QTest::newRow("MFCC_0_D") << 1 << 0u << 0x2106u;
+    QTest::newRow("MFCC_0_D_A") << 2 << 0u << 0x2306u;
+    QTest::newRow("USER") << 1 << unsigned(ShapeFeature) << 9u;
+}
+
+/* The 12 byte header and the values are big-endian. sampPeriod is the frame shift in 100 ns units and sampSize the
+ * bytes of a frame. In MFCC kinds C0 follows c1 .. c12 in the static block and in each delta block, USER files keep
+ * the order of the frames.
+ */
+void TestFeatureFile::htkLayout() {
+    QFETCH(int, deltaOrder);
+    QFETCH(unsigned, spectralFeatures);
+    QFETCH(unsigned, parmKind);
+    const size_t frames = 37;
+    QVERIFY(dir.isValid());
+    QString fileName = dir.filePath("htk.mfc");
+    FeatureFileInfo info = testInfo(deltaOrder, spectralFeatures);
+    QVERIFY(writeFile(fileName, info, HtkFeatureFile, frames));
+
+    std::vector<uchar> bytes = readBytes(fileName);
+    QCOMPARE(bytes.size(), 12 + frames * info.dims * sizeof(float));
+    QCOMPARE(qFromBigEndian<quint32>(&bytes[0]), quint32(frames));
+    QCOMPARE(qFromBigEndian<quint32>(&bytes[4]), quint32(info.config.frameShift * 10000));
+    QCOMPARE(qFromBigEndian<quint16>(&bytes[8]), quint16(info.dims * sizeof(float)));
+    QCOMPARE(qFromBigEndian<quint16>(&bytes[10]), quint16(parmKind));
+
+    size_t cepstra = info.config.numCepstral;
+    for (size_t i=0; i<frames; i++) {
+        for (size_t d=0; d<info.dims; d++) {
+            // Position in the frame of the value stored at d
+            size_t source = d;
+            if (spectralFeatures == 0) {
+                size_t block = d / (cepstra + 1) * (cepstra + 1);
+                source = d - block == cepstra ? block : d + 1;
+            }
+            quint32 bits = qFromBigEndian<quint32>(&bytes[12 + (i * info.dims + d) * sizeof(float)]);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            QVERIFY2(value == float(testValue(i, source)), qPrintable(QString("frame %1 value %2").arg(i).arg(d)));
+        }
+    }
+
+    // Not a native feature file
+    FeatureFile file;
+    QVERIFY(!file.open(fileName));
+}
+
+static TestRegistration<TestFeatureFile> registration;
+
+#include "tst_featurefile.moc"
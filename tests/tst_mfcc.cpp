@@ -0,0 +1,343 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "fixedpointmfcc.h"
+#include "mfccextractor.h"
+#include "tests.h"
+
+/* Allocation counter
+ * The global operator new of this executable counts the allocations made while countAllocations is set, so a test
+ * can check that a stretch of code does not touch the heap.
+ */
+static std::atomic<bool> countAllocations(false);
+static std::atomic<long> allocationCount(0);
+
+void* operator new(std::size_t size) {
+    if (countAllocations)
+        allocationCount++;
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    free(p);
+}
+
+// Counts the allocations of its lifetime
+class AllocationScope
+{
+public:
+    AllocationScope() { allocationCount = 0; countAllocations = true; }
+    ~AllocationScope() { countAllocations = false; }
+    long count() const { return allocationCount; }
+};
+
+class TestMfcc : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void frameLoopAllocatesNothing_data();
+    void frameLoopAllocatesNothing();
+    void streamAllocatesNothing();
+    void blockAllocatesOnlyItsOutput();
+    void detectedKernelsMatchScalar_data();
+    void detectedKernelsMatchScalar();
+    void fixedPointWithinBound_data();
+    void fixedPointWithinBound();
+    void deltasMatchOfflineRegression_data();
+    void deltasMatchOfflineRegression();
+};
+
+void TestMfcc::frameLoopAllocatesNothing_data() {
+    QTest::addColumn<int>("backend");
+    QTest::addColumn<unsigned>("features");
+    QTest::newRow("builtin") << (int) BuiltinFFT << 0u;
+    QTest::newRow("fftw") << (int) FFTW << 0u;
+    QTest::newRow("spectral") << (int) BuiltinFFT << (unsigned) (ChromaFeature | ShapeFeature | RmsFeature);
+}
+
+// Steady state of processFrame: the circular buffer and the scratch arrays are sized by configure
+void TestMfcc::frameLoopAllocatesNothing() {
+    QFETCH(int, backend);
+    QFETCH(unsigned, features);
+
+    MfccExtractor<double> extractor;
+    extractor.setSpectrumBackend((SpectrumBackend) backend);
+    extractor.setSpectralFeatures(features);
+    std::vector<int16_t> samples = testSignal(extractor.overlapSamples() + 200 * extractor.shiftSamples());
+
+    extractor.setOverlap(samples.data());
+    const int16_t* frame = samples.data() + extractor.overlapSamples();
+    for (size_t k=0; k<10; k++, frame += extractor.shiftSamples())
+        extractor.processFrame(frame);
+
+    AllocationScope scope;
+    double sum = 0;
+    for (size_t k=10; k<200; k++, frame += extractor.shiftSamples())
+        sum += extractor.processFrame(frame)[1];
+    QCOMPARE(scope.count(), 0L);
+    QVERIFY(sum == sum);
+}
+
+// Steady state of a stream with deltas and delta-deltas, fed in chunks that split frames
+void TestMfcc::streamAllocatesNothing() {
+    MfccExtractor<float> extractor;
+    extractor.setDeltaOrder(2);
+    std::vector<int16_t> samples = testSignal(44100 * 4);
+
+    size_t numFrames = 0;
+    MfccExtractor<float>::FrameCallback callback = [&numFrames](const std::vector<float> &) { numFrames++; };
+    extractor.resetStream();
+    extractor.pushSamples(samples.data(), 44100, callback);
+
+    {
+        AllocationScope scope;
+        for (size_t i=44100; i<samples.size(); i+=1000)
+            extractor.pushSamples(samples.data() + i, std::min((size_t) 1000, samples.size() - i), callback);
+        QCOMPARE(scope.count(), 0L);
+    }
+    extractor.finishStream(callback);
+    QCOMPARE(numFrames, (samples.size() - extractor.overlapSamples()) / extractor.shiftSamples());
+}
+
+// processBlock allocates the vector of every frame it returns and nothing else
+void TestMfcc::blockAllocatesOnlyItsOutput() {
+    MfccExtractor<double> extractor;
+    const size_t numFrames = 300;
+    std::vector<int16_t> samples = testSignal(extractor.overlapSamples() + (numFrames + 64) * extractor.shiftSamples());
+    std::vector<std::vector<double>> mfccs;
+    mfccs.reserve(numFrames + 64);
+
+    extractor.setOverlap(samples.data());
+    const int16_t* block = samples.data() + extractor.overlapSamples();
+    extractor.processBlock(block, 64, mfccs);
+
+    AllocationScope scope;
+    extractor.processBlock(block + 64 * extractor.shiftSamples(), numFrames, mfccs);
+    QCOMPARE(scope.count(), (long) numFrames);
+}
+
+// Largest difference between the frames and blocks of the detected and the scalar kernels
+template <typename T>
+static double maxKernelDifference(const std::vector<int16_t> &samples, unsigned features) {
+    MfccExtractor<T> simd, scalar;
+    simd.setKernels(mfccKernelsDetected<T>());
+    scalar.setKernels(mfccKernelsScalar<T>());
+    simd.setSpectralFeatures(features);
+    scalar.setSpectralFeatures(features);
+
+    size_t numFrames = (samples.size() - simd.overlapSamples()) / simd.shiftSamples();
+    double difference = 0;
+    simd.setOverlap(samples.data());
+    scalar.setOverlap(samples.data());
+    const int16_t* frame = samples.data() + simd.overlapSamples();
+    for (size_t k=0; k<numFrames/2; k++, frame += simd.shiftSamples()) {
+        const std::vector<T> &a = simd.processFrame(frame);
+        const std::vector<T> &b = scalar.processFrame(frame);
+        for (size_t i=0; i<a.size(); i++)
+            difference = std::max(difference, std::abs(double(a[i]) - double(b[i])));
+    }
+
+    std::vector<std::vector<T>> a, b;
+    simd.processBlock(frame, numFrames - numFrames/2, a);
+    scalar.processBlock(frame, numFrames - numFrames/2, b);
+    for (size_t k=0; k<a.size(); k++)
+        for (size_t i=0; i<a[k].size(); i++)
+            difference = std::max(difference, std::abs(double(a[k][i]) - double(b[k][i])));
+    return difference;
+}
+
+void TestMfcc::detectedKernelsMatchScalar_data() {
+    QTest::addColumn<bool>("single");
+    QTest::addColumn<unsigned>("features");
+    QTest::addColumn<double>("tolerance");
+    QTest::newRow("double") << false << 0u << 1e-9;
+    QTest::newRow("double spectral") << false << (unsigned) (ChromaFeature | ShapeFeature | RmsFeature) << 1e-9;
+    QTest::newRow("float") << true << 0u << 1e-3;
+    QTest::newRow("float spectral") << true << (unsigned) (ChromaFeature | ShapeFeature | RmsFeature) << 1e-3;
+}
+
+// The SIMD kernels only reorder the sums of the scalar ones, the MFCCs agree up to rounding
+void TestMfcc::detectedKernelsMatchScalar() {
+    QFETCH(bool, single);
+    QFETCH(unsigned, features);
+    QFETCH(double, tolerance);
+
+    bool scalar = single ? &mfccKernelsDetected<float>() == &mfccKernelsScalar<float>()
+                         : &mfccKernelsDetected<double>() == &mfccKernelsScalar<double>();
+    if (scalar)
+        QSKIP("No SIMD kernels on this CPU");
+
+    std::vector<int16_t> samples = testSignal(44100 * 3, 2);
+    double difference = single ? maxKernelDifference<float>(samples, features)
+                               : maxKernelDifference<double>(samples, features);
+    qDebug() << (single ? mfccKernelsDetected<float>().name : mfccKernelsDetected<double>().name)
+             << "kernels differ from scalar by" << difference;
+    QVERIFY(difference < tolerance);
+}
+
+void TestMfcc::fixedPointWithinBound_data() {
+    QTest::addColumn<int>("fs");
+    QTest::addColumn<double>("level");
+    QTest::addColumn<double>("tone");
+    QTest::addColumn<double>("bound");
+    const int rates[] = { 44100, 16000 };
+    for (int fs : rates) {
+        double bound = fs == 44100 ? 3e-3 : 2e-3;
+        const double levels[] = { 0, -20, -40, -60, -80 };
+        for (double level : levels) {
+            QTest::newRow(qPrintable(QString("%1 Hz noise %2 dBFS").arg(fs).arg(level))) << fs << level << 0.0 << bound;
+            QTest::newRow(qPrintable(QString("%1 Hz 440 Hz %2 dBFS").arg(fs).arg(level))) << fs << level << 440.0 << bound;
+        }
+    }
+    QTest::newRow("16000 Hz noise -20 dBFS, loud bound") << 16000 << -20.0 << 0.0 << 2e-4;
+}
+
+// The error bound documented by FixedPointMfcc, against MfccExtractor<double> on the same frames
+void TestMfcc::fixedPointWithinBound() {
+    QFETCH(int, fs);
+    QFETCH(double, level);
+    QFETCH(double, tone);
+    QFETCH(double, bound);
+
+    // Gaussian noise clipped at full scale, or a tone, at level dBFS
+    std::mt19937 generator(3);
+    std::normal_distribution<double> normal(0, 1);
+    double amplitude = 32767 * std::pow(10, level / 20);
+    std::vector<int16_t> samples(fs * 2);
+    for (size_t i=0; i<samples.size(); i++) {
+        double x = tone > 0 ? amplitude * std::sin(2 * M_PI * tone * i / fs) : amplitude / 3 * normal(generator);
+        samples[i] = (int16_t) std::lround(std::max(-32768.0, std::min(32767.0, x)));
+    }
+
+    MfccExtractor<double> reference(fs);
+    reference.setSpectrumBackend(BuiltinFFT);
+    FixedPointMfcc fixedPoint;
+    fixedPoint.configure(reference.config());
+    QCOMPARE(fixedPoint.shiftSamples(), reference.shiftSamples());
+
+    size_t numFrames = (samples.size() - reference.overlapSamples()) / reference.shiftSamples();
+    std::vector<std::vector<double>> expected, actual;
+    reference.setOverlap(samples.data());
+    reference.processBlock(samples.data() + reference.overlapSamples(), numFrames, expected);
+    fixedPoint.setOverlap(samples.data());
+    fixedPoint.processBlock(samples.data() + fixedPoint.overlapSamples(), numFrames, actual);
+
+    double error = 0;
+    for (size_t k=0; k<numFrames; k++)
+        for (size_t i=0; i<expected[k].size(); i++)
+            error = std::max(error, std::abs(actual[k][i] - expected[k][i]));
+    QVERIFY2(error < bound, qPrintable(QString("error %1").arg(error)));
+}
+
+/* The regression of every frame over the whole matrix, d(t) = sum_k k * (c(t+k) - c(t-k)) / (2 * sum_k k^2), with the
+ * frames before the first and after the last clamped to them
+ */
+static std::vector<std::vector<double>> regression(const std::vector<std::vector<double>> &frames, size_t window) {
+    double norm = 0;
+    for (size_t k=1; k<=window; k++)
+        norm += 2.0 * k * k;
+    size_t n = frames.size();
+    std::vector<std::vector<double>> deltas(n, std::vector<double>(n ? frames[0].size() : 0, 0.0));
+    for (size_t t=0; t<n; t++)
+        for (size_t k=1; k<=window; k++)
+            for (size_t d=0; d<deltas[t].size(); d++)
+                deltas[t][d] += k * (frames[std::min(t + k, n - 1)][d] - frames[t >= k ? t - k : 0][d]) / norm;
+    return deltas;
+}
+
+void TestMfcc::deltasMatchOfflineRegression_data() {
+    QTest::addColumn<int>("order");
+    QTest::addColumn<int>("window");
+    QTest::addColumn<int>("frames");
+
+    QTest::newRow("static only") << 0 << 2 << 50;
+    QTest::newRow("deltas, one frame") << 1 << 2 << 1;
+    QTest::newRow("deltas, window 1") << 1 << 1 << 50;
+    QTest::newRow("deltas, window 2") << 1 << 2 << 200;
+    QTest::newRow("delta-deltas, one frame") << 2 << 2 << 1;
+    QTest::newRow("delta-deltas, fewer frames than the latency") << 2 << 2 << 3;
+    QTest::newRow("delta-deltas, window 2") << 2 << 2 << 200;
+    QTest::newRow("delta-deltas, window 3") << 2 << 3 << 200;
+}
+
+/* The streamed frames must be the regressions over the whole matrix, the edge frames included, and each one must come
+ * out exactly latency() frames after it went in, the rest on flush(). A second stream after reset() must not see the
+ * first one.
+ */
+void TestMfcc::deltasMatchOfflineRegression() {
+    QFETCH(int, order);
+    QFETCH(int, window);
+    QFETCH(int, frames);
+    const size_t dims = 13;
+
+    std::mt19937 generator(4);
+    std::normal_distribution<double> normal(0, 1);
+    std::vector<std::vector<double>> expected(frames, std::vector<double>(dims));
+    for (std::vector<double> &frame : expected)
+        for (double &x : frame)
+            x = normal(generator);
+    std::vector<std::vector<double>> statics = expected;
+    std::vector<std::vector<double>> deltas = statics;
+    for (int s=1; s<=order; s++) {
+        deltas = regression(deltas, window);
+        for (int t=0; t<frames; t++)
+            expected[t].insert(expected[t].end(), deltas[t].begin(), deltas[t].end());
+    }
+
+    DeltaFilter<double> filter(dims, order, window);
+    QCOMPARE(filter.latency(), size_t(order * window));
+    QCOMPARE(filter.outputSize(), dims * (order + 1));
+    for (int pass=0; pass<2; pass++) {
+        filter.reset();
+        std::vector<std::vector<double>> streamed;
+        for (int t=0; t<frames; t++) {
+            const std::vector<double>* frame = filter.push(statics[t].data());
+            QVERIFY2((frame != 0) == (size_t(t) >= filter.latency()), qPrintable(QString("frame %1").arg(t)));
+            if (frame)
+                streamed.push_back(*frame);
+        }
+        while (const std::vector<double>* frame = filter.flush())
+            streamed.push_back(*frame);
+        QVERIFY(!filter.flush());
+
+        QCOMPARE(streamed.size(), expected.size());
+        double error = 0;
+        for (int t=0; t<frames; t++) {
+            QCOMPARE(streamed[t].size(), expected[t].size());
+            for (size_t i=0; i<expected[t].size(); i++)
+                error = std::max(error, std::abs(streamed[t][i] - expected[t][i]));
+        }
+        QVERIFY2(error < 1e-12, qPrintable(QString("error %1").arg(error)));
+    }
+}
+
+static TestRegistration<TestMfcc> registration;
+
+#include "tst_mfcc.moc"
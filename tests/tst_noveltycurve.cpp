@@ -0,0 +1,132 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "noveltycurve.h"
+#include "tests.h"
+
+// Segments of segmentFrames frames, each a noisy copy of its own random base vector
+static std::vector<std::vector<double>> segmentedFrames(size_t n, size_t segmentFrames, unsigned seed = 1) {
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> normal(0, 1);
+    std::vector<double> base(13);
+    std::vector<std::vector<double>> frames(n, std::vector<double>(13));
+    for (size_t i=0; i<n; i++) {
+        if (i % segmentFrames == 0)
+            for (double &x : base)
+                x = normal(generator);
+        for (size_t d=0; d<13; d++)
+            frames[i][d] = base[d] + 0.3 * normal(generator);
+    }
+    return frames;
+}
+
+/* Foote's novelty straight from the definition: the 2W x 2W checkerboard kernel centred on frame t, +g for pairs on
+ * the same side of t and -g across it, with g a Gaussian of standard deviation taper * W, correlated with the full
+ * matrix off the diagonal. The measures are distances, so the sum is negated, and the kernel is normalised to an
+ * absolute sum of 1.
+ */
+static std::vector<double> directNovelty(const PackedSimilarityMatrix<float> &matrix, size_t W, double taper) {
+    size_t n = matrix.size();
+    double sigma = taper * W;
+    std::vector<double> novelty(n >= W ? n - W + 1 : 0, 0.0);
+    for (size_t t=W; t<novelty.size(); t++) {
+        double sum = 0, total = 0;
+        for (size_t i=t-W; i<t+W; i++) {
+            for (size_t j=t-W; j<t+W; j++) {
+                if (i == j)
+                    continue;
+                double a = i + 0.5 - t, b = j + 0.5 - t;
+                double g = exp(-(a*a + b*b) / (2*sigma*sigma));
+                sum += ((i >= t) == (j >= t) ? g : -g) * matrix(i, j);
+                total += g;
+            }
+        }
+        novelty[t] = -sum / total;
+    }
+    return novelty;
+}
+
+class TestNoveltyCurve : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesDirectConvolution_data();
+    void matchesDirectConvolution();
+    void findsSegmentBoundaries();
+};
+
+void TestNoveltyCurve::matchesDirectConvolution_data() {
+    QTest::addColumn<int>("frames");
+    QTest::addColumn<int>("halfWidth");
+
+    QTest::newRow("shorter than the kernel") << 20 << 16;
+    QTest::newRow("W 8") << 300 << 8;
+    QTest::newRow("W 32") << 500 << 32;
+}
+
+/* The curve followed frame by frame along a growing band, as SelfSimilarity does, must be the direct correlation with
+ * the full matrix. The band is pushed in steps of 7 frames, so the values become final at different frames.
+ */
+void TestNoveltyCurve::matchesDirectConvolution() {
+    QFETCH(int, frames);
+    QFETCH(int, halfWidth);
+    std::vector<std::vector<double>> vectors = segmentedFrames(frames, 50);
+
+    FeatureMatrix features;
+    features.assign(vectors);
+    PackedSimilarityMatrix<float> matrix;
+    computeSimilarityMatrix(features, matrix);
+    std::vector<double> expected = directNovelty(matrix, halfWidth, 0.5);
+
+    NoveltyCurve curve(halfWidth, 0.5);
+    BandedSimilarityMatrix<float> narrow(curve.requiredLag() - 1);
+    QVERIFY(!curve.update(narrow));
+
+    BandedSimilarityStream<float> stream;
+    BandedSimilarityMatrix<float> band;
+    stream.reset(band, curve.requiredLag());
+    for (size_t i=0; i<vectors.size(); i++) {
+        stream.push(vectors[i].data(), vectors[i].size(), band);
+        if (i % 7 == 6 || i + 1 == vectors.size())
+            QVERIFY(curve.update(band));
+    }
+
+    QCOMPARE(curve.size(), expected.size());
+    double peak = 1e-30, error = 0;
+    for (size_t t=0; t<expected.size(); t++) {
+        peak = std::max(peak, std::abs(expected[t]));
+        error = std::max(error, std::abs(curve.values()[t] - expected[t]));
+    }
+    QVERIFY2(error <= 1e-5 * peak, qPrintable(QString("error %1 of %2").arg(error).arg(peak)));
+}
+
+// Segments of 60 frames, each boundary must be a peak of the curve and there must be no other
+void TestNoveltyCurve::findsSegmentBoundaries() {
+    const size_t W = 16;
+    std::vector<std::vector<double>> vectors = segmentedFrames(600, 60, 2);
+
+    FeatureMatrix features;
+    features.assign(vectors);
+    BandedSimilarityMatrix<float> band;
+    computeBandedSimilarity(features, 2*W - 1, band);
+    NoveltyCurve curve(W);
+    QVERIFY(curve.update(band));
+
+    float peak = *std::max_element(curve.values().begin(), curve.values().end());
+    std::vector<size_t> boundaries = curve.boundaries(0.2f * peak);
+    std::vector<size_t> expected;
+    for (size_t t=60; t+W<=600; t+=60)
+        expected.push_back(t);
+    QCOMPARE(boundaries.size(), expected.size());
+    for (size_t k=0; k<expected.size(); k++)
+        QVERIFY2(boundaries[k] == expected[k], qPrintable(QString("boundary %1 at %2").arg(expected[k]).arg(boundaries[k])));
+}
+
+static TestRegistration<TestNoveltyCurve> registration;
+
+#include "tst_noveltycurve.moc"
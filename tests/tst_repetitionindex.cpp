@@ -0,0 +1,118 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "repetitionindex.h"
+#include "tests.h"
+
+/* 1000 independent random frames, with frames [100, 300) repeated at [600, 800) under a little noise. Inside the
+ * repeat the frames 650 .. 652 are replaced by fresh ones, a gap of three dissimilar frames.
+ */
+static FeatureMatrix repeatFeatures() {
+    std::mt19937 generator(7);
+    std::normal_distribution<double> normal(0, 1);
+    std::vector<std::vector<double>> frames(1000, std::vector<double>(13));
+    for (std::vector<double> &frame : frames)
+        for (double &x : frame)
+            x = normal(generator);
+    for (size_t i=0; i<200; i++)
+        for (size_t d=0; d<13; d++)
+            frames[600 + i][d] = frames[100 + i][d] + 0.05 * normal(generator);
+    for (size_t i=650; i<653; i++)
+        for (size_t d=0; d<13; d++)
+            frames[i][d] = normal(generator);
+
+    FeatureMatrix features;
+    features.assign(frames);
+    return features;
+}
+
+class TestRepetitionIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void pairsAreExactPairs_data();
+    void pairsAreExactPairs();
+    void findsRepeatedSegment();
+};
+
+void TestRepetitionIndex::pairsAreExactPairs_data() {
+    QTest::addColumn<int>("numTables");
+    QTest::addColumn<int>("bitsPerTable");
+    QTest::addColumn<int>("minLag");
+    QTest::addColumn<double>("minRecall");
+
+    QTest::newRow("12 x 16 bits") << 12 << 16 << 1 << 0.99;
+    QTest::newRow("12 x 16 bits, lag 300") << 12 << 16 << 300 << 0.99;
+    QTest::newRow("4 x 20 bits") << 4 << 20 << 1 << 0.9;
+}
+
+/* The index verifies its candidates with the exact measure, so every pair it reports must be an exact pair with the
+ * same distance, once and in (i, j) order. It may miss pairs, the recall must stay above the floor of its tables.
+ */
+void TestRepetitionIndex::pairsAreExactPairs() {
+    QFETCH(int, numTables);
+    QFETCH(int, bitsPerTable);
+    QFETCH(int, minLag);
+    QFETCH(double, minRecall);
+    const float maxDistance = 0.01f;
+    FeatureMatrix features = repeatFeatures();
+
+    std::vector<SimilarPair> exact = exactSimilarPairs(features, maxDistance, minLag);
+    RepetitionIndex index(numTables, bitsPerTable);
+    index.build(features);
+    std::vector<SimilarPair> pairs = index.similarPairs(features, maxDistance, minLag);
+    QVERIFY(!exact.empty());
+
+    auto before = [](const SimilarPair &a, const SimilarPair &b) { return a.i < b.i || (a.i == b.i && a.j < b.j); };
+    QVERIFY(std::is_sorted(exact.begin(), exact.end(), before));
+    for (size_t k=0; k<pairs.size(); k++) {
+        const SimilarPair &pair = pairs[k];
+        QVERIFY2(k == 0 || before(pairs[k - 1], pair), qPrintable(QString("pair %1 out of order").arg(k)));
+        QVERIFY(pair.i >= pair.j + minLag);
+        auto found = std::lower_bound(exact.begin(), exact.end(), pair, before);
+        QVERIFY2(found != exact.end() && found->i == pair.i && found->j == pair.j && found->distance == pair.distance,
+                 qPrintable(QString("frames %1 and %2 are no exact pair").arg(pair.i).arg(pair.j)));
+    }
+
+    double recall = double(pairs.size()) / exact.size();
+    QVERIFY2(recall >= minRecall, qPrintable(QString("recall %1").arg(recall)));
+}
+
+/* The repeat is one segment along lag 500 when the gap of three frames is bridged, and two segments around the gap
+ * when it is not. Random frames that happen to be similar stay single pairs and are dropped.
+ */
+void TestRepetitionIndex::findsRepeatedSegment() {
+    FeatureMatrix features = repeatFeatures();
+    RepetitionIndex index;
+    index.build(features);
+    std::vector<SimilarPair> pairs = index.similarPairs(features, 0.01f, 100);
+    std::vector<SimilarPair> exact = exactSimilarPairs(features, 0.01f, 100);
+
+    std::vector<RepeatedSegment> segments = RepetitionIndex::repeatedSegments(exact, 20);
+    QCOMPARE(segments.size(), size_t(1));
+    QCOMPARE(segments[0].first, size_t(100));
+    QCOMPARE(segments[0].repeat, size_t(600));
+    QCOMPARE(segments[0].length, size_t(200));
+
+    segments = RepetitionIndex::repeatedSegments(exact, 20, 0);
+    QCOMPARE(segments.size(), size_t(2));
+    QCOMPARE(segments[0].first, size_t(100));
+    QCOMPARE(segments[0].length, size_t(50));
+    QCOMPARE(segments[1].first, size_t(153));
+    QCOMPARE(segments[1].repeat, size_t(653));
+    QCOMPARE(segments[1].length, size_t(147));
+
+    // The index may miss a few pairs, which the default gap bridges
+    segments = RepetitionIndex::repeatedSegments(pairs, 20);
+    QCOMPARE(segments.size(), size_t(1));
+    QCOMPARE(segments[0].repeat - segments[0].first, size_t(500));
+    QVERIFY(segments[0].first <= 102 && segments[0].first + segments[0].length >= 298);
+}
+
+static TestRegistration<TestRepetitionIndex> registration;
+
+#include "tst_repetitionindex.moc"
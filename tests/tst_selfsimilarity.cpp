@@ -0,0 +1,71 @@
+#include <QtTest>
+
+#include <vector>
+
+#include "self-similarity.h"
+#include "tests.h"
+
+// The globals the application defines in main.cpp and SelfSimilarity fills
+QVector<qint16> levels;
+PackedSimilarityMatrix<float> similarityMatrix;
+BandedSimilarityMatrix<float> bandedSimilarity;
+SimilarityFile similarityFile;
+SimilarityPyramid similarityPyramid;
+
+class TestSelfSimilarity : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parallelMatchesBlock_data();
+    void parallelMatchesBlock();
+};
+
+void TestSelfSimilarity::parallelMatchesBlock_data() {
+    QTest::addColumn<bool>("continued");
+    QTest::addColumn<unsigned>("spectral");
+    QTest::addColumn<bool>("fixedPoint");
+
+    QTest::newRow("one call") << false << 0u << false;
+    QTest::newRow("continued") << true << 0u << false;
+    QTest::newRow("one call, spectral") << false << unsigned(ChromaFeature | ShapeFeature | RmsFeature) << false;
+    QTest::newRow("continued, spectral") << true << unsigned(ChromaFeature | ShapeFeature | RmsFeature) << false;
+    QTest::newRow("continued, fixed point") << true << 0u << true;
+}
+
+/* processParallelTo cuts the frames into chunks of blockFrames for the workers. Whether the frames come in one call or
+ * continue those of an earlier call, every frame must equal the one of a single processBlockTo over the recording.
+ * The spectral flux of the first frame of a chunk depends on the frame in front of it, also across calls.
+ */
+void TestSelfSimilarity::parallelMatchesBlock() {
+    QFETCH(bool, continued);
+    QFETCH(unsigned, spectral);
+    QFETCH(bool, fixedPoint);
+
+    SelfSimilarity analysis;
+    analysis.setSpectrumBackend(BuiltinFFT);
+    analysis.setSpectralFeatures(spectral);
+    analysis.setFixedPoint(fixedPoint);
+
+    // Several chunks and a partial one in both calls
+    const size_t numFrames = 5 * MfccExtractor<double>::blockFrames + 7;
+    const size_t split = continued ? 2 * MfccExtractor<double>::blockFrames + 3 : 0;
+    size_t shift = analysis.shiftSamples();
+    std::vector<int16_t> samples = testSignal(analysis.overlapSamples() + numFrames * shift);
+
+    std::vector<std::vector<double>> expected, actual;
+    analysis.setOverlap(samples.data());
+    analysis.processBlockTo(samples.data() + analysis.overlapSamples(), numFrames, expected);
+
+    if (split > 0)
+        analysis.processParallelTo(samples.data(), split, actual);
+    analysis.processParallelTo(samples.data() + split * shift, numFrames - split, actual, split > 0);
+
+    QCOMPARE(actual.size(), expected.size());
+    for (size_t k=0; k<numFrames; k++)
+        QVERIFY2(actual[k] == expected[k], qPrintable(QString("frame %1").arg(k)));
+}
+
+static TestRegistration<TestSelfSimilarity> registration;
+
+#include "tst_selfsimilarity.moc"
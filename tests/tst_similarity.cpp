@@ -0,0 +1,208 @@
+#include <QtTest>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "similaritymatrix.h"
+#include "tests.h"
+
+// Frames of dims Gaussian values, none of them zero
+static std::vector<std::vector<double>> randomFrames(size_t n, size_t dims = 13, unsigned seed = 1) {
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> normal(0, 1);
+    std::vector<std::vector<double>> frames(n, std::vector<double>(dims));
+    for (size_t i=0; i<n; i++)
+        for (size_t d=0; d<dims; d++)
+            frames[i][d] = normal(generator);
+    return frames;
+}
+
+static FeatureMatrix randomFeatures(size_t n, size_t dims = 13, unsigned seed = 1) {
+    FeatureMatrix features;
+    features.assign(randomFrames(n, dims, seed));
+    return features;
+}
+
+template <typename T>
+static bool sameBytes(const PackedSimilarityMatrix<T> &a, const PackedSimilarityMatrix<T> &b) {
+    return a.size() == b.size() && a.storedSize() == b.storedSize()
+           && (a.size() == 0 || memcmp(a.row(0), b.row(0), a.storedSize() * sizeof(T)) == 0);
+}
+
+template <typename T>
+static bool sameBytes(const BandedSimilarityMatrix<T> &a, const BandedSimilarityMatrix<T> &b) {
+    if (a.size() != b.size() || a.maxLag() != b.maxLag())
+        return false;
+    for (size_t l=0; l<=a.maxLag() && l<a.size(); l++)
+        if (memcmp(a.lag(l) + l, b.lag(l) + l, (a.size() - l) * sizeof(T)) != 0)
+            return false;
+    return true;
+}
+
+class TestSimilarity : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void parallelMatchesSerial_data();
+    void parallelMatchesSerial();
+    void bandMatchesFullMatrix_data();
+    void bandMatchesFullMatrix();
+    void extendMatchesFullMatrix();
+    void bandedUpdatesMatchBatch();
+};
+
+// The parallel paths fall back to one thread on a single core, the tests want several workers
+void TestSimilarity::initTestCase() {
+    QThreadPool::globalInstance()->setMaxThreadCount(std::max(QThreadPool::globalInstance()->maxThreadCount(), 4));
+}
+
+// Frame counts below, at and past the 32 x 128 tiles, none of them a multiple of both
+void TestSimilarity::parallelMatchesSerial_data() {
+    QTest::addColumn<int>("frames");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("31") << 31;
+    QTest::newRow("129") << 129;
+    QTest::newRow("790") << 790;
+}
+
+void TestSimilarity::parallelMatchesSerial() {
+    QFETCH(int, frames);
+    FeatureMatrix features = randomFeatures(frames);
+
+    PackedSimilarityMatrix<float> serial, parallel;
+    computeSimilarityMatrix(features, serial);
+    computeSimilarityMatrixParallel(features, parallel);
+    QCOMPARE(serial.size(), size_t(frames));
+    QVERIFY(sameBytes(serial, parallel));
+
+    PackedSimilarityMatrix<double> serialDouble, parallelDouble;
+    computeSimilarityMatrix(features, serialDouble);
+    computeSimilarityMatrixParallel(features, parallelDouble);
+    QVERIFY(sameBytes(serialDouble, parallelDouble));
+
+    // The measures themselves, against the dot product of the rows
+    double error = 0;
+    for (size_t i=0; i<serialDouble.size(); i++) {
+        for (size_t j=0; j<=i; j++) {
+            double dot = 0;
+            for (size_t d=0; d<features.dims(); d++)
+                dot += features.row(i)[d] * features.row(j)[d];
+            error = std::max(error, std::abs(serialDouble(i, j) - (1 - dot)));
+        }
+    }
+    QVERIFY2(error < 1e-12, qPrintable(QString("error %1").arg(error)));
+}
+
+void TestSimilarity::bandMatchesFullMatrix_data() {
+    QTest::addColumn<int>("frames");
+    QTest::addColumn<int>("maxLag");
+
+    QTest::newRow("1 frame") << 1 << 0;
+    QTest::newRow("diagonal only") << 129 << 0;
+    QTest::newRow("129 frames, lag 31") << 129 << 31;
+    QTest::newRow("790 frames, lag 100") << 790 << 100;
+    QTest::newRow("band wider than the frames") << 50 << 200;
+}
+
+/* The band holds the measures of the full matrix with |i - j| <= maxLag, computed by dotRows with the same row first,
+ * so they are the same values. The parallel band is the serial one.
+ */
+void TestSimilarity::bandMatchesFullMatrix() {
+    QFETCH(int, frames);
+    QFETCH(int, maxLag);
+    FeatureMatrix features = randomFeatures(frames, 13, 2);
+
+    PackedSimilarityMatrix<float> full;
+    BandedSimilarityMatrix<float> banded, parallel;
+    computeSimilarityMatrix(features, full);
+    computeBandedSimilarity(features, maxLag, banded);
+    computeBandedSimilarityParallel(features, maxLag, parallel);
+    QCOMPARE(banded.size(), size_t(frames));
+    QCOMPARE(banded.maxLag(), size_t(maxLag));
+    QCOMPARE(parallel.size(), size_t(frames));
+
+    for (size_t i=0; i<banded.size(); i++) {
+        for (size_t j=0; j<=i; j++) {
+            if (i - j > size_t(maxLag)) {
+                QVERIFY(!banded.contains(i, j) && !banded.contains(j, i));
+                continue;
+            }
+            QVERIFY(banded.contains(i, j) && banded.contains(j, i));
+            QVERIFY2(banded(i, j) == full(i, j) && banded(j, i) == full(i, j),
+                     qPrintable(QString("frames %1 and %2").arg(i).arg(j)));
+            QVERIFY2(parallel(i, j) == banded(i, j), qPrintable(QString("frames %1 and %2").arg(i).arg(j)));
+        }
+    }
+}
+
+// Frames arriving in ragged chunks, the extended matrix must be the one computed at once
+void TestSimilarity::extendMatchesFullMatrix() {
+    const size_t chunks[] = { 1, 30, 2, 127, 1, 200, 429 };
+    std::vector<std::vector<double>> frames = randomFrames(790, 13, 3);
+
+    FeatureMatrix all;
+    all.assign(frames);
+    PackedSimilarityMatrix<float> full;
+    computeSimilarityMatrix(all, full);
+
+    FeatureMatrix growing;
+    PackedSimilarityMatrix<float> serial, parallel;
+    size_t n = 0;
+    for (size_t chunk : chunks) {
+        for (size_t i=n; i<n+chunk; i++)
+            growing.append(frames[i].data(), frames[i].size());
+        n += chunk;
+        extendSimilarityMatrix(growing, serial);
+        extendSimilarityMatrixParallel(growing, parallel);
+        QCOMPARE(serial.size(), n);
+        QVERIFY2(sameBytes(serial, parallel), qPrintable(QString("%1 frames").arg(n)));
+    }
+    QCOMPARE(n, all.rows());
+    QVERIFY(sameBytes(serial, full));
+}
+
+/* The band built frame by frame by BandedSimilarityStream, and the band extended in ragged chunks, must be the one of
+ * computeBandedSimilarity. 2100 frames take the storage of every lag across two geometric resizes, at 1024 and 2048
+ * frames, with frames moved to the new layout in between.
+ */
+void TestSimilarity::bandedUpdatesMatchBatch() {
+    const size_t maxLag = 40;
+    const size_t chunks[] = { 1, 500, 523, 1, 2, 1000, 73 };
+    std::vector<std::vector<double>> frames = randomFrames(2100, 13, 4);
+
+    FeatureMatrix all;
+    all.assign(frames);
+    BandedSimilarityMatrix<float> batch;
+    computeBandedSimilarity(all, maxLag, batch);
+
+    BandedSimilarityStream<float> stream;
+    BandedSimilarityMatrix<float> streamed;
+    stream.reset(streamed, maxLag);
+    for (size_t i=0; i<frames.size(); i++)
+        stream.push(frames[i].data(), frames[i].size(), streamed);
+    QVERIFY(sameBytes(streamed, batch));
+
+    FeatureMatrix growing;
+    BandedSimilarityMatrix<float> extended(maxLag);
+    size_t n = 0;
+    for (size_t chunk : chunks) {
+        for (size_t i=n; i<n+chunk; i++)
+            growing.append(frames[i].data(), frames[i].size());
+        n += chunk;
+        extendBandedSimilarityParallel(growing, extended);
+        QCOMPARE(extended.size(), n);
+    }
+    QCOMPARE(n, all.rows());
+    QVERIFY(sameBytes(extended, batch));
+}
+
+static TestRegistration<TestSimilarity> registration;
+
+#include "tst_similarity.moc"
@@ -0,0 +1,122 @@
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "similaritypyramid.h"
+#include "tests.h"
+
+typedef std::vector<std::vector<double>> SquareMatrix;
+
+// Every level of the brute force pyramid as a full square, pooled 2 x 2 from the level before
+static SquareMatrix poolSquare(const SquareMatrix &source, SimilarityPooling pooling) {
+    size_t n = source.size();
+    size_t m = (n + 1) / 2;
+    SquareMatrix pooled(m, std::vector<double>(m));
+    for (size_t I=0; I<m; I++) {
+        for (size_t J=0; J<m; J++) {
+            double sum = 0, minimum = INFINITY;
+            size_t count = 0;
+            for (size_t r=2*I; r<std::min(2*I + 2, n); r++) {
+                for (size_t c=2*J; c<std::min(2*J + 2, n); c++) {
+                    sum += source[r][c];
+                    minimum = std::min(minimum, source[r][c]);
+                    count++;
+                }
+            }
+            pooled[I][J] = pooling == MinPooling ? minimum : sum / count;
+        }
+    }
+    return pooled;
+}
+
+class TestSimilarityPyramid : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesBruteForce_data();
+    void matchesBruteForce();
+};
+
+void TestSimilarityPyramid::matchesBruteForce_data() {
+    QTest::addColumn<int>("pooling");
+    QTest::addColumn<int>("frames");
+
+    QTest::newRow("mean, 2 frames") << int(MeanPooling) << 2;
+    QTest::newRow("mean, 64 frames") << int(MeanPooling) << 64;
+    QTest::newRow("mean, 333 frames") << int(MeanPooling) << 333;
+    QTest::newRow("min, 64 frames") << int(MinPooling) << 64;
+    QTest::newRow("min, 333 frames") << int(MinPooling) << 333;
+}
+
+/* Every level must be the brute force pooling of the full matrix, and the pyramid updated while the matrix grows in
+ * ragged steps must be the one built at once. Odd sizes leave partial blocks at the end of every level.
+ */
+void TestSimilarityPyramid::matchesBruteForce() {
+    QFETCH(int, pooling);
+    QFETCH(int, frames);
+
+    std::mt19937 generator(5);
+    std::normal_distribution<double> normal(0, 1);
+    std::vector<std::vector<double>> vectors(frames, std::vector<double>(13));
+    for (std::vector<double> &v : vectors)
+        for (double &x : v)
+            x = normal(generator);
+
+    // The same frames at once and in ragged steps, the last step takes the rest
+    const size_t steps[] = { 1, 2, 61, 3 };
+    FeatureMatrix features, growing;
+    features.assign(vectors);
+    PackedSimilarityMatrix<float> matrix, grown;
+    computeSimilarityMatrix(features, matrix);
+
+    SimilarityPyramid pyramid, updated;
+    pyramid.setPooling(SimilarityPooling(pooling));
+    updated.setPooling(SimilarityPooling(pooling));
+    pyramid.update(matrix);
+
+    size_t n = 0;
+    for (size_t k=0; n<size_t(frames); k++) {
+        size_t step = k < sizeof(steps) / sizeof(steps[0]) ? std::min(steps[k], frames - n) : frames - n;
+        for (size_t i=n; i<n+step; i++)
+            growing.append(vectors[i].data(), vectors[i].size());
+        n += step;
+        extendSimilarityMatrix(growing, grown);
+        updated.update(grown);
+        QCOMPARE(updated.size(), n);
+    }
+
+    SquareMatrix level(frames, std::vector<double>(frames));
+    for (int i=0; i<frames; i++)
+        for (int j=0; j<frames; j++)
+            level[i][j] = matrix(i, j);
+
+    QCOMPARE(pyramid.firstLevel(), size_t(1));
+    QCOMPARE(updated.numLevels(), pyramid.numLevels());
+    for (size_t k=1; k<pyramid.numLevels(); k++) {
+        level = poolSquare(level, SimilarityPooling(pooling));
+        const PackedSimilarityMatrix<float> &pooled = pyramid.level(k);
+        QCOMPARE(pooled.size(), level.size());
+
+        double error = 0;
+        for (size_t I=0; I<pooled.size(); I++)
+            for (size_t J=0; J<=I; J++)
+                error = std::max(error, std::abs(pooled(I, J) - level[I][J]));
+        QVERIFY2(error < (pooling == MinPooling ? 1e-7 : 1e-6),
+                 qPrintable(QString("level %1 error %2").arg(k).arg(error)));
+
+        const PackedSimilarityMatrix<float> &incremental = updated.level(k);
+        QCOMPARE(incremental.size(), pooled.size());
+        QVERIFY2(memcmp(incremental.row(0), pooled.row(0), pooled.storedSize() * sizeof(float)) == 0,
+                 qPrintable(QString("level %1").arg(k)));
+    }
+    QCOMPARE(pyramid.level(pyramid.numLevels() - 1).size(), size_t(1));
+}
+
+static TestRegistration<TestSimilarityPyramid> registration;
+
+#include "tst_similaritypyramid.moc"
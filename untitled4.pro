@@ -6,22 +6,48 @@ QT += multimedia
 
 HEADERS += \
     audioengine.h \
+    decimator.h \
+    featurefile.h \
+    fftplan.h \
+    fixedpointmfcc.h \
+    mfccextractor.h \
+    noveltycurve.h \
     paintedlevels.h \
+    repetitionindex.h \
     restful.h \
     self-similarity.h \
+    similarityfile.h \
+    similaritymatrix.h \
+    similaritypyramid.h \
+    simdkernels.h \
+    spectralfeatures.h \
     wavfile.h
 
 SOURCES += main.cpp \
     audioengine.cpp \
+    decimator.cpp \
+    featurefile.cpp \
+    fftplan.cpp \
+    fixedpointmfcc.cpp \
+    mfccextractor.cpp \
+    noveltycurve.cpp \
     paintedlevels.cpp \
+    repetitionindex.cpp \
     restful.cpp \
     self-similarity.cpp \
+    similarityfile.cpp \
+    similaritymatrix.cpp \
+    similaritypyramid.cpp \
+    simdkernels.cpp \
+    spectralfeatures.cpp \
     wavfile.cpp
 
 RESOURCES += qml.qrc
 
 LIBS += libfftw3.a
 
+include(simdkernels.pri)
+
 # Additional import path used to resolve QML modules in Qt Creator's code model
 QML_IMPORT_PATH =
 